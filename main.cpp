@@ -9,715 +9,6619 @@
 #include <string>
 #include <map>
 #include <sstream>
+#include <climits>
+#include <algorithm>
+#include <bit>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <optional>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <iterator>
+#include <span>
+#include <utility>
+#include <cstdio>
+#include <string_view>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <charconv>
+#include <cstring>
+#include <cctype>
+#include <deque>
+#include <filesystem>
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#include <io.h>
+#include <fcntl.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
-void drawArrow(sf::RenderWindow &window, const sf::Font& font, const sf::Vector2f &start, const sf::Vector2f &end,
-               const sf::Color &color, const std::string& weightStr) {
-    sf::Vector2f dir = end - start;
-    float fullLen = std::sqrt(dir.x*dir.x + dir.y*dir.y);
-    if (fullLen <= 0.0001f) return;
-    sf::Vector2f unit = dir / fullLen;
-
-    float nodeOffset = 22.f;
-    float arrowHeadSize = 18.f;
-    float thickness = 5.f;
-
-    sf::Vector2f newStart = start + unit * nodeOffset;
-    sf::Vector2f newEnd = end - unit * nodeOffset;
-
-    float bodyLen = std::sqrt((newEnd.x - newStart.x)*(newEnd.x - newStart.x) + (newEnd.y - newStart.y)*(newEnd.y - newStart.y));
-    if (bodyLen <= 0.0001f) return;
-
-    sf::RectangleShape body;
-    body.setSize({ bodyLen, thickness });
-    body.setOrigin({ 0.f, thickness/2.f });
-    body.setPosition(newStart);
-
-    float angleDeg = std::atan2(unit.y, unit.x) * 180.f / 3.14159265f;
-
-    body.setRotation(sf::degrees(angleDeg));
-    body.setFillColor(color);
-    window.draw(body);
-
-    sf::ConvexShape head;
-    head.setPointCount(3);
-    head.setPoint(0, sf::Vector2f(0.f, 0.f));
-    head.setPoint(1, sf::Vector2f(-arrowHeadSize, arrowHeadSize/2.f));
-    head.setPoint(2, sf::Vector2f(-arrowHeadSize, -arrowHeadSize/2.f));
-    head.setFillColor(color);
-    head.setPosition(newEnd);
-    head.setRotation(sf::degrees(angleDeg));
-    window.draw(head);
-
-    sf::Text weightText(font);
-    weightText.setString(weightStr);
-    weightText.setCharacterSize(16);
-    weightText.setFillColor(sf::Color::White);
-
-    sf::Vector2f textPos = newStart + unit * (bodyLen / 2.f);
-    sf::Vector2f perpendicular = sf::Vector2f(-unit.y, unit.x);
-    textPos += perpendicular * 15.f;
-
-    sf::FloatRect textRect = weightText.getLocalBounds();
-    weightText.setOrigin({textRect.position.x + textRect.size.x / 2.0f,
-                         textRect.position.y + textRect.size.y / 2.0f});
-    weightText.setPosition(textPos);
-    window.draw(weightText);
-}
-
-std::vector<int> bfsOrder(const std::vector<std::vector<int>>& adj, std::vector<int>& parent, int start = 0) {
-    int n = (int)adj.size();
-    std::vector<int> vis(n, 0), ord;
-    std::queue<int> q;
-    q.push(start);
-    vis[start] = 1;
-    parent[start] = -1;
-    while (!q.empty()) {
-        int u = q.front(); q.pop();
-        ord.push_back(u);
-        for (int v = 0; v < n; ++v) {
-            if (adj[u][v] && !vis[v]) {
-                vis[v] = 1;
-                parent[v] = u;
-                q.push(v);
-            }
-        }
-    }
-    return ord;
+double elapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
 }
 
-std::vector<int> dijkstraOrder(const std::vector<std::vector<int>>& adj, std::vector<int>& parent,
-                               std::vector<long long>& dist, int start = 0) {
-    int n = (int)adj.size();
-    dist.assign(n, LLONG_MAX);
-    std::vector<int> vis(n, 0), ord;
-    parent.assign(n, -1);
+// Installed RAM, or 0 when the platform will not say.
+unsigned long long physicalMemoryBytes() {
+#if defined(_WIN32)
+    MEMORYSTATUSEX status{};
+    status.dwLength = sizeof(status);
+    if (!GlobalMemoryStatusEx(&status)) return 0;
+    return status.ullTotalPhys;
+#else
+    long pages = sysconf(_SC_PHYS_PAGES), pageSize = sysconf(_SC_PAGESIZE);
+    if (pages <= 0 || pageSize <= 0) return 0;
+    return (unsigned long long)pages * (unsigned long long)pageSize;
+#endif
+}
 
-    dist[start] = 0;
+// Hot-path counters and phase timers that the algorithms fill in as they run. Each thread
+// bumps its own block with relaxed atomics, which costs a plain add, and a reader (the metrics
+// overlay, a batch run) sums every block whenever it likes. Building with -DGV_NO_METRICS
+// turns GV_COUNT and GV_TIME into nothing.
+enum class Metric {
+    NodesSettled, EdgesScanned, Relaxations, HeapPushes, HeapPops, HeapDecreaseKeys, BytesEncoded, BytesDecoded, Count
+};
+enum class MetricTimer { Preprocess, Search, Encode, Decode, Count };
 
-    for (int i = 0; i < n; ++i) {
-        int u = -1;
-        for (int j = 0; j < n; ++j) {
-            if (!vis[j] && (u == -1 || dist[j] < dist[u])) {
-                u = j;
-            }
-        }
+constexpr int kMetricCount = (int)Metric::Count;
+constexpr int kMetricTimerCount = (int)MetricTimer::Count;
+const char* const kMetricNames[kMetricCount] = {"nodes_settled", "edges_scanned", "relaxations", "heap_pushes",
+                                                "heap_pops", "heap_decrease_keys", "bytes_encoded", "bytes_decoded"};
+const char* const kMetricTimerNames[kMetricTimerCount] = {"preprocess", "search", "encode", "decode"};
 
-        if (u == -1 || dist[u] == LLONG_MAX) break;
+struct MetricsSnapshot {
+    std::array<long long, kMetricCount> counts{};
+    std::array<long long, kMetricTimerCount> nanos{};   // summed over threads, so it can exceed wall time
 
-        vis[u] = 1;
-        ord.push_back(u);
+    MetricsSnapshot operator-(const MetricsSnapshot& base) const {
+        MetricsSnapshot d;
+        for (int i = 0; i < kMetricCount; ++i) d.counts[i] = counts[i] - base.counts[i];
+        for (int i = 0; i < kMetricTimerCount; ++i) d.nanos[i] = nanos[i] - base.nanos[i];
+        return d;
+    }
 
-        for (int v = 0; v < n; ++v) {
-            if (adj[u][v] != 0 && dist[u] + adj[u][v] < dist[v]) {
-                dist[v] = dist[u] + adj[u][v];
-                parent[v] = u;
-            }
+    long long operator[](Metric m) const { return counts[(int)m]; }
+    double ms(MetricTimer t) const { return nanos[(int)t] / 1e6; }
+};
+
+struct MetricBlock {
+    std::array<std::atomic<long long>, kMetricCount> counts{};
+    std::array<std::atomic<long long>, kMetricTimerCount> nanos{};
+};
+
+class MetricsRegistry {
+public:
+    MetricBlock* add() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return &blocks.emplace_back();
+    }
+
+    MetricsSnapshot snapshot() {
+        MetricsSnapshot s;
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const MetricBlock& block : blocks) {
+            for (int i = 0; i < kMetricCount; ++i) s.counts[i] += block.counts[i].load(std::memory_order_relaxed);
+            for (int i = 0; i < kMetricTimerCount; ++i) s.nanos[i] += block.nanos[i].load(std::memory_order_relaxed);
         }
+        return s;
     }
-    return ord;
+
+private:
+    std::mutex mutex;
+    std::deque<MetricBlock> blocks;   // a deque never moves its elements
+};
+
+MetricsRegistry& metricsRegistry() {
+    static MetricsRegistry registry;
+    return registry;
 }
 
-bool bellmanFord(const std::vector<std::vector<int>>& adj, std::vector<int>& parent,
-                   std::vector<long long>& dist, int start = 0) {
-    int n = (int)adj.size();
-    dist.assign(n, LLONG_MAX);
-    parent.assign(n, -1);
+// A thread's block outlives the thread, so what it counted still shows up in snapshots.
+constinit inline thread_local MetricBlock* threadMetrics = nullptr;
 
-    dist[start] = 0;
+inline MetricBlock& localMetrics() {
+    if (!threadMetrics) threadMetrics = metricsRegistry().add();
+    return *threadMetrics;
+}
 
-    for (int i = 1; i <= n - 1; ++i) {
-        for (int u = 0; u < n; ++u) {
-            for (int v = 0; v < n; ++v) {
-                int weight = adj[u][v];
-                if (weight != 0 && dist[u] != LLONG_MAX && dist[u] + weight < dist[v]) {
-                    dist[v] = dist[u] + weight;
-                    parent[v] = u;
-                }
-            }
-        }
+inline void bumpMetric(std::atomic<long long>& slot, long long amount) {
+    slot.store(slot.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+MetricsSnapshot metricsSnapshot() { return metricsRegistry().snapshot(); }
+
+class ScopedMetricTimer {
+public:
+    explicit ScopedMetricTimer(MetricTimer timer) : timer(timer), start(std::chrono::steady_clock::now()) {}
+    ~ScopedMetricTimer() {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+        bumpMetric(localMetrics().nanos[(int)timer], ns.count());
     }
 
+private:
+    MetricTimer timer;
+    std::chrono::steady_clock::time_point start;
+};
+
+#ifndef GV_NO_METRICS
+constexpr bool kMetricsEnabled = true;
+#define GV_COUNT(metric, amount) bumpMetric(localMetrics().counts[(int)Metric::metric], (amount))
+#define GV_TIME(timer) ScopedMetricTimer metricTimer(MetricTimer::timer)
+#else
+constexpr bool kMetricsEnabled = false;
+#define GV_COUNT(metric, amount) ((void)sizeof(amount))
+#define GV_TIME(timer) ((void)0)
+#endif
+
+struct CsrArrays {
+    std::vector<long long> offsets;
+    std::vector<int> targets;
+    std::vector<int> weights;
+};
+
+// Read-only view of a compressed-sparse-row graph. `storage` keeps whatever backs the spans alive:
+// owned CsrArrays for graphs built in memory, or a file mapping for binary snapshots.
+struct CsrGraph {
+    int n = 0;
+    std::span<const long long> offsets;
+    std::span<const int> targets;
+    std::span<const int> weights;
+    std::shared_ptr<const void> storage;
+
+    long long edgeCount() const { return (long long)targets.size(); }
+};
+
+CsrGraph makeCsrGraph(int n, CsrArrays&& arrays) {
+    auto owned = std::make_shared<CsrArrays>(std::move(arrays));
+    CsrGraph g;
+    g.n = n;
+    g.offsets = owned->offsets;
+    g.targets = owned->targets;
+    g.weights = owned->weights;
+    g.storage = owned;
+    return g;
+}
+
+struct WeightedEdge {
+    int u;
+    int v;
+    int w;
+};
+
+CsrGraph csrFromMatrix(const std::vector<std::vector<int>>& adj) {
+    int n = (int)adj.size();
+    CsrArrays a;
+    a.offsets.assign(n + 1, 0);
     for (int u = 0; u < n; ++u) {
+        long long deg = 0;
         for (int v = 0; v < n; ++v) {
-            int weight = adj[u][v];
-            if (weight != 0 && dist[u] != LLONG_MAX && dist[u] + weight < dist[v]) {
-                return true;
+            if (adj[u][v] != 0) deg++;
+        }
+        a.offsets[u + 1] = a.offsets[u] + deg;
+    }
+    a.targets.reserve(a.offsets[n]);
+    a.weights.reserve(a.offsets[n]);
+    for (int u = 0; u < n; ++u) {
+        for (int v = 0; v < n; ++v) {
+            if (adj[u][v] != 0) {
+                a.targets.push_back(v);
+                a.weights.push_back(adj[u][v]);
             }
         }
     }
+    return makeCsrGraph(n, std::move(a));
+}
 
-    return false;
+// Index of the lightest u -> v edge, or -1 if there is none.
+long long findEdge(const CsrGraph& g, int u, int v) {
+    auto first = g.targets.begin() + g.offsets[u];
+    auto last = g.targets.begin() + g.offsets[u + 1];
+    auto it = std::lower_bound(first, last, v);
+    if (it == last || *it != v) return -1;
+    return it - g.targets.begin();
 }
 
-int minKey(int n, const std::vector<int>& key, const std::vector<bool>& inMST) {
-    int minVal = INT_MAX, minIndex = -1;
-    for (int v = 0; v < n; ++v) {
-        if (!inMST[v] && key[v] < minVal) {
-            minVal = key[v];
-            minIndex = v;
+CsrGraph transposeCsr(const CsrGraph& g) {
+    CsrArrays t;
+    t.offsets.assign(g.n + 1, 0);
+    for (int v : g.targets) t.offsets[v + 1]++;
+    for (int v = 0; v < g.n; ++v) t.offsets[v + 1] += t.offsets[v];
+    t.targets.resize(g.targets.size());
+    t.weights.resize(g.weights.size());
+    std::vector<long long> fill(t.offsets.begin(), t.offsets.end() - 1);
+    for (int u = 0; u < g.n; ++u) {
+        for (long long e = g.offsets[u]; e < g.offsets[u + 1]; ++e) {
+            long long slot = fill[g.targets[e]]++;
+            t.targets[slot] = u;
+            t.weights[slot] = g.weights[e];
         }
     }
-    return minIndex;
+    return makeCsrGraph(g.n, std::move(t));
 }
 
-std::vector<int> mstPrimsOrder(const std::vector<std::vector<int>>& adj, std::vector<int>& parent, int start = 0) {
-    int n = (int)adj.size();
-    std::vector<int> key(n, INT_MAX);
-    std::vector<bool> inMST(n, false);
-    std::vector<int> ord;
+enum class TraceKind : uint8_t { Visit, Relax, Push, Pop };
 
-    key[start] = 0;
-    parent[start] = -1;
+// 16 bytes per event: the kind sits in the low two bits of `head` and the vertex above them.
+// Relax carries the improving predecessor in `from` and the new distance (or key) in `value`.
+struct TraceEvent {
+    uint32_t head;
+    int32_t from;
+    int64_t value;
 
-    for (int count = 0; count < n; ++count) {
-        int u = minKey(n, key, inMST);
-        if (u == -1) break;
+    TraceKind kind() const { return (TraceKind)(head & 3u); }
+    int vertex() const { return (int)(head >> 2); }
+};
 
-        inMST[u] = true;
-        ord.push_back(u);
+// Lock-free single-producer/single-consumer ring between an algorithm thread and the render
+// loop. The producer caches the consumer's index and only re-reads it when the ring looks full,
+// then yields until there is room; once the consumer abandons the ring, pushes are dropped so
+// the algorithm can still run to completion.
+class EventRing {
+public:
+    explicit EventRing(int capacityLog2 = 18) : slots(size_t(1) << capacityLog2), mask(slots.size() - 1) {}
 
-        for (int v = 0; v < n; ++v) {
-            if (adj[u][v] > 0 && !inMST[v] && adj[u][v] < key[v]) {
-                parent[v] = u;
-                key[v] = adj[u][v];
+    void push(TraceKind kind, int v, int from, long long value) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h - producerTail == slots.size()) {
+            while ((producerTail = tail.load(std::memory_order_acquire)) + slots.size() == h) {
+                if (abandoned.load(std::memory_order_relaxed)) return;
+                std::this_thread::yield();
             }
         }
+        slots[h & mask] = TraceEvent{((uint32_t)v << 2) | (uint32_t)kind, from, value};
+        head.store(h + 1, std::memory_order_release);
     }
-    return ord;
-}
-
-float heuristic(int nodeA, int nodeB, const std::vector<sf::Vector2f>& pos) {
-    sf::Vector2f dir = pos[nodeB] - pos[nodeA];
-    return std::sqrt(dir.x * dir.x + dir.y * dir.y);
-}
 
-std::vector<int> aStarOrder(const std::vector<std::vector<int>>& adj, std::vector<int>& parent,
-                            std::vector<long long>& gScore, const std::vector<sf::Vector2f>& pos,
-                            int start, int dest) {
-    int n = (int)adj.size();
-    gScore.assign(n, LLONG_MAX);
-    std::vector<float> fScore(n, std::numeric_limits<float>::infinity());
-    std::vector<int> vis(n, 0), ord;
-    parent.assign(n, -1);
+    // Called by the producer after its last push; everything it wrote before is visible to a
+    // consumer whose drain() returns true.
+    void close() { closed.store(true, std::memory_order_release); }
 
-    gScore[start] = 0;
-    fScore[start] = heuristic(start, dest, pos);
+    void abandon() { abandoned.store(true, std::memory_order_relaxed); }
 
-    for (int i = 0; i < n; ++i) {
-        int u = -1;
-        float minF = std::numeric_limits<float>::infinity();
+    // Appends up to `limit` available events to out; returns true once the producer has closed
+    // the ring and nothing is left to drain. Events left behind keep the producer waiting.
+    bool drain(std::vector<TraceEvent>& out, size_t limit = SIZE_MAX) {
+        bool done = closed.load(std::memory_order_acquire);
+        size_t t = tail.load(std::memory_order_relaxed);
+        size_t h = head.load(std::memory_order_acquire);
+        size_t stop = h - t > limit ? t + limit : h;
+        for (; t != stop; ++t) out.push_back(slots[t & mask]);
+        tail.store(t, std::memory_order_release);
+        return done && t == h;
+    }
 
-        for (int j = 0; j < n; ++j) {
-            if (!vis[j] && fScore[j] < minF) {
-                minF = fScore[j];
-                u = j;
-            }
-        }
+private:
+    std::vector<TraceEvent> slots;
+    size_t mask;
+    alignas(64) std::atomic<size_t> head{0};
+    size_t producerTail = 0;
+    alignas(64) std::atomic<size_t> tail{0};
+    std::atomic<bool> closed{false};
+    std::atomic<bool> abandoned{false};
+};
 
-        if (u == -1) break;
+inline void traceEvent(EventRing* trace, TraceKind kind, int v, int from = -1, long long value = 0) {
+    if (trace) trace->push(kind, v, from, value);
+}
 
-        vis[u] = 1;
+std::vector<int> bfsOrder(const CsrGraph& g, std::vector<int>& parent, int start = 0, EventRing* trace = nullptr) {
+    int n = g.n;
+    std::vector<int> vis(n, 0), ord;
+    std::queue<int> q;
+    q.push(start);
+    traceEvent(trace, TraceKind::Push, start);
+    vis[start] = 1;
+    parent[start] = -1;
+    while (!q.empty()) {
+        int u = q.front(); q.pop();
+        traceEvent(trace, TraceKind::Pop, u);
         ord.push_back(u);
-
-        if (u == dest) break;
-
-        for (int v = 0; v < n; ++v) {
-            if (adj[u][v] != 0) {
-                long long tentative_gScore = gScore[u] + adj[u][v];
-                if (tentative_gScore < gScore[v]) {
-                    parent[v] = u;
-                    gScore[v] = tentative_gScore;
-                    fScore[v] = (float)gScore[v] + heuristic(v, dest, pos);
-                }
+        traceEvent(trace, TraceKind::Visit, u);
+        GV_COUNT(NodesSettled, 1);
+        GV_COUNT(EdgesScanned, g.offsets[u + 1] - g.offsets[u]);
+        for (long long e = g.offsets[u]; e < g.offsets[u + 1]; ++e) {
+            int v = g.targets[e];
+            if (!vis[v]) {
+                GV_COUNT(Relaxations, 1);
+                vis[v] = 1;
+                parent[v] = u;
+                traceEvent(trace, TraceKind::Relax, v, u);
+                q.push(v);
+                traceEvent(trace, TraceKind::Push, v);
             }
         }
     }
     return ord;
 }
 
-void visualizeGraph(const std::vector<std::vector<int>>& adj,
-                    const std::vector<int>& order,
-                    const std::vector<int>& parent,
-                    const std::set<std::pair<int, int>>& shortestPathEdges,
-                    const std::vector<long long>& dist,
-                    const std::vector<sf::Vector2f>& pos,
-                    const std::string& title,
-                    int destIndex,
-                    long long totalCost)
-{
-    int n = (int)adj.size();
-    sf::RenderWindow window(sf::VideoMode(sf::Vector2u{800u, 600u}), title);
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned threadCount) {
+        for (unsigned i = 1; i < threadCount; ++i) {
+            workers.emplace_back([this, i] { workerLoop(i); });
+        }
+    }
 
-    sf::Font font;
-    if (!font.openFromFile("C:/Windows/Fonts/arial.ttf")) {
-        std::cerr << "Error: Could not load font 'arial.ttf'.\n";
-        return;
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& t : workers) t.join();
     }
 
-    float radius = 20.f;
+    unsigned size() const { return (unsigned)workers.size() + 1; }
 
-    std::vector<sf::Color> nodeColor(n, sf::Color(200,200,200));
-    sf::Color visitedNodeColor = sf::Color::Cyan;
-    sf::Color visitingArrowColor = sf::Color::Yellow;
-    sf::Color visitedArrowColor = sf::Color::Red;
-    sf::Color finalPathColor = sf::Color::Green;
+    // Calls fn(lo, hi, worker) over [begin, end) in chunks of `grain`; worker is in [0, size()).
+    template <typename Fn>
+    void parallelFor(long long begin, long long end, long long grain, Fn&& fn) {
+        if (begin >= end) return;
+        grain = std::max(1LL, grain);
+        if (workers.empty() || insidePool || end - begin <= grain) {
+            fn(begin, end, 0u);
+            return;
+        }
+        std::atomic<long long> next{begin};
+        std::function<void(unsigned)> body = [&](unsigned worker) {
+            while (true) {
+                long long lo = next.fetch_add(grain);
+                if (lo >= end) break;
+                fn(lo, std::min(lo + grain, end), worker);
+            }
+        };
+        run(body);
+    }
 
-    sf::Text titleText(font);
-    titleText.setString(title);
-    titleText.setCharacterSize(24);
-    titleText.setFillColor(sf::Color::White);
-    titleText.setStyle(sf::Text::Bold);
-    sf::FloatRect titleRect = titleText.getLocalBounds();
-    titleText.setOrigin({titleRect.position.x + titleRect.size.x / 2.0f,
-                         titleRect.position.y + titleRect.size.y / 2.0f});
-    titleText.setPosition({400.f, 30.f});
+private:
+    std::vector<std::thread> workers;
+    std::mutex submitMutex;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    const std::function<void(unsigned)>* job = nullptr;
+    unsigned long long generation = 0;
+    size_t pending = 0;
+    bool stopping = false;
+    static inline thread_local bool insidePool = false;
 
-    sf::Text infoText(font);
-    infoText.setCharacterSize(20);
-    infoText.setFillColor(sf::Color::White);
-    infoText.setPosition({30.f, 70.f});
+    void run(const std::function<void(unsigned)>& body) {
+        std::lock_guard<std::mutex> submit(submitMutex);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &body;
+            pending = workers.size();
+            generation++;
+        }
+        wake.notify_all();
+        insidePool = true;
+        body(0);
+        insidePool = false;
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [&] { return pending == 0; });
+        job = nullptr;
+    }
 
-    sf::Text statusText(font);
-    statusText.setCharacterSize(20);
-    statusText.setFillColor(sf::Color::White);
-    statusText.setPosition({30.f, 550.f});
+    void workerLoop(unsigned index) {
+        insidePool = true;
+        unsigned long long seen = 0;
+        while (true) {
+            const std::function<void(unsigned)>* task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+                task = job;
+            }
+            (*task)(index);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--pending == 0) finished.notify_one();
+            }
+        }
+    }
+};
 
-    sf::Clock clk;
-    size_t step = 0;
-    bool animationComplete = false;
+// The first call fixes the pool size; 0 means one thread per hardware core.
+ThreadPool& sharedThreadPool(unsigned threads = 0) {
+    static ThreadPool pool(threads ? threads : std::max(1u, std::thread::hardware_concurrency()));
+    return pool;
+}
 
-    while (window.isOpen()) {
-        for (auto ev = window.pollEvent(); ev.has_value(); ev = window.pollEvent()) {
-            if (ev->is<sf::Event::Closed>()) window.close();
-        }
+// Rows come out sorted by target (ties by weight), which edgeWeight's binary search relies on.
+// Edges are first partitioned into vertex-range buckets and then laid out bucket by bucket, so the
+// random writes of the final scatter stay inside a cache-sized window. Chunks are partitioned in parallel,
+// which lets loaders hand over their per-thread edge buffers as-is.
+CsrGraph csrFromEdgeChunks(int n, const std::vector<std::span<const WeightedEdge>>& chunks,
+                           ThreadPool& pool = sharedThreadPool()) {
+    long long m = 0;
+    for (const auto& chunk : chunks) m += (long long)chunk.size();
+    int bucketCount = (int)std::clamp<long long>(m / 65536, 1, std::max(1, n));
+    int bucketWidth = std::max(1, (n + bucketCount - 1) / bucketCount);
+    size_t chunkCount = chunks.size();
 
-        if (step < order.size() && clk.getElapsedTime().asSeconds() > 0.5f) {
-            nodeColor[order[step]] = visitedNodeColor;
-            step++;
-            clk.restart();
-        }
-        if (step == order.size()) {
-            animationComplete = true;
+    std::vector<long long> cursor(chunkCount * bucketCount, 0);
+    pool.parallelFor(0, (long long)chunkCount, 1, [&](long long lo, long long hi, unsigned) {
+        for (long long c = lo; c < hi; ++c) {
+            long long* counts = &cursor[c * bucketCount];
+            for (const auto& e : chunks[c]) counts[e.u / bucketWidth]++;
         }
+    });
 
-        if (animationComplete) {
-            statusText.setString("Done! Final path in green.");
-        } else {
-            std::string status = "Step: " + std::to_string(step) + " / " + std::to_string(order.size());
-            if (step < order.size()) {
-                status += " (Visiting Node " + std::to_string(order[step] + 1) + ")";
-            }
-            statusText.setString(status);
+    std::vector<long long> bucketStart(bucketCount + 1, 0);
+    long long running = 0;
+    for (int b = 0; b < bucketCount; ++b) {
+        bucketStart[b] = running;
+        for (size_t c = 0; c < chunkCount; ++c) {
+            long long count = cursor[c * bucketCount + b];
+            cursor[c * bucketCount + b] = running;
+            running += count;
         }
+    }
+    bucketStart[bucketCount] = running;
 
-        if (title.find("MST") != std::string::npos) {
-            infoText.setString("Total MST Cost: " + std::to_string(totalCost));
-        } else if (title.find("BFS") != std::string::npos) {
-            infoText.setString("Total Cost: N/A (unweighted)");
-        } else if (title.find("Dijkstra") != std::string::npos || title.find("Bellman-Ford") != std::string::npos || title.find("A*") != std::string::npos) {
-            if (destIndex != -1) {
-                std::string dStr = (dist[destIndex] == LLONG_MAX) ? "inf" : std::to_string(dist[destIndex]);
-                infoText.setString("Shortest Path to Node " + std::to_string(destIndex + 1) + ": " + dStr);
-            } else {
-                infoText.setString("Destination: Not Selected");
-            }
+    std::vector<WeightedEdge> bucketed(m);
+    pool.parallelFor(0, (long long)chunkCount, 1, [&](long long lo, long long hi, unsigned) {
+        for (long long c = lo; c < hi; ++c) {
+            long long* next = &cursor[c * bucketCount];
+            for (const auto& e : chunks[c]) bucketed[next[e.u / bucketWidth]++] = e;
         }
+    });
 
-        window.clear(sf::Color(30,30,40));
+    CsrArrays a;
+    a.offsets.assign(n + 1, 0);
+    a.targets.resize(m);
+    a.weights.resize(m);
+    pool.parallelFor(0, bucketCount, 1, [&](long long lo, long long hi, unsigned) {
+        std::vector<long long> fill;
+        std::vector<unsigned long long> packed;
+        for (long long b = lo; b < hi; ++b) {
+            int first = (int)std::min<long long>(n, b * bucketWidth);
+            int last = (int)std::min<long long>(n, first + (long long)bucketWidth);
+            long long begin = bucketStart[b], end = bucketStart[b + 1];
 
-        if (animationComplete) {
-            for (int j = 0; j < n; ++j) {
-                int i = parent[j];
-                if (i != -1 && nodeColor[j] == visitedNodeColor) {
-                    if (shortestPathEdges.find({i, j}) == shortestPathEdges.end()) {
-                        drawArrow(window, font, pos[i], pos[j], visitedArrowColor, std::to_string(adj[i][j]));
-                    }
-                }
+            fill.assign(last - first + 1, 0);
+            for (long long i = begin; i < end; ++i) fill[bucketed[i].u - first + 1]++;
+            for (int u = first; u < last; ++u) {
+                fill[u - first + 1] += fill[u - first];
+                a.offsets[u] = begin + fill[u - first];
             }
 
-            for (const auto& edge : shortestPathEdges) {
-                int i = edge.first;
-                int j = edge.second;
-                drawArrow(window, font, pos[i], pos[j], finalPathColor, std::to_string(adj[i][j]));
+            packed.resize(end - begin);
+            for (long long i = begin; i < end; ++i) {
+                const WeightedEdge& e = bucketed[i];
+                packed[fill[e.u - first]++] = ((unsigned long long)e.v << 32) | ((unsigned)e.w ^ 0x80000000u);
             }
-
-        } else {
-            for (size_t k = 0; k < step; ++k) {
-                int j = order[k];
-                int i = parent[j];
-
-                if (i != -1) {
-                    sf::Color arrowColor;
-                    if (k == step - 1) {
-                        arrowColor = visitingArrowColor;
-                    } else {
-                        arrowColor = visitedArrowColor;
-                    }
-                    drawArrow(window, font, pos[i], pos[j], arrowColor, std::to_string(adj[i][j]));
-                }
+            for (int u = first; u < last; ++u) {
+                long long rowBegin = a.offsets[u] - begin;
+                long long rowEnd = (u + 1 < last ? a.offsets[u + 1] : end) - begin;
+                std::sort(packed.begin() + rowBegin, packed.begin() + rowEnd);
+            }
+            for (long long i = begin; i < end; ++i) {
+                a.targets[i] = (int)(packed[i - begin] >> 32);
+                a.weights[i] = (int)((unsigned)packed[i - begin] ^ 0x80000000u);
             }
         }
+    });
+    a.offsets[n] = m;
+    return makeCsrGraph(n, std::move(a));
+}
 
-        for (int i = 0; i < n; ++i) {
-            sf::CircleShape node(radius);
-            node.setOrigin({radius, radius});
-            node.setPosition(pos[i]);
-            node.setFillColor(nodeColor[i]);
-            node.setOutlineThickness(2.f);
-            node.setOutlineColor(sf::Color(240, 240, 240));
-            window.draw(node);
+CsrGraph csrFromEdges(int n, const std::vector<WeightedEdge>& edges, ThreadPool& pool = sharedThreadPool()) {
+    std::vector<std::span<const WeightedEdge>> chunks;
+    size_t step = std::max<size_t>(1 << 16, edges.size() / (pool.size() * 4) + 1);
+    for (size_t i = 0; i < edges.size(); i += step) {
+        chunks.emplace_back(edges.data() + i, std::min(step, edges.size() - i));
+    }
+    return csrFromEdgeChunks(n, chunks, pool);
+}
 
-            sf::Text text(font);
-            text.setString(std::to_string(i + 1));
-            text.setCharacterSize(18);
-            text.setFillColor(sf::Color::Black);
+class AtomicBitmap {
+public:
+    explicit AtomicBitmap(int bits) : words((bits + 63) / 64) {}
+
+    bool test(int i) const {
+        return (words[i >> 6].load(std::memory_order_relaxed) >> (i & 63)) & 1ULL;
+    }
 
-            sf::FloatRect textRect = text.getLocalBounds();
-            text.setOrigin({textRect.position.x + textRect.size.x / 2.0f,
-                           textRect.position.y + textRect.size.y / 2.0f});
-            text.setPosition(pos[i]);
-            window.draw(text);
+    void set(int i) {
+        words[i >> 6].fetch_or(1ULL << (i & 63), std::memory_order_relaxed);
+    }
 
-            if (title.find("Dijkstra") != std::string::npos || title.find("Bellman-Ford") != std::string::npos || title.find("A*") != std::string::npos) {
-                sf::Text distText(font);
-                distText.setCharacterSize(16);
-                distText.setFillColor(sf::Color::White);
+    // Returns true if this call flipped the bit from 0 to 1.
+    bool claim(int i) {
+        unsigned long long mask = 1ULL << (i & 63);
+        return !(words[i >> 6].fetch_or(mask, std::memory_order_relaxed) & mask);
+    }
 
-                std::string dStr = "d = ";
-                if (dist[i] == LLONG_MAX) {
-                    dStr += "inf";
-                } else {
-                    dStr += std::to_string(dist[i]);
-                }
+    void clear() {
+        for (auto& w : words) w.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    std::vector<std::atomic<unsigned long long>> words;
+};
+
+// Beamer-style BFS: top-down while the frontier is small, bottom-up over in-edges once the
+// frontier's out-edges outnumber the unexplored edges by `alpha`, back when it shrinks below n / beta.
+std::vector<int> bfsDirectionOptimizing(const CsrGraph& g, std::vector<int>& parent, int start = 0,
+                                        ThreadPool& pool = sharedThreadPool()) {
+    const long long alpha = 15, beta = 18;
+    int n = g.n;
+    parent.assign(n, -1);
+    AtomicBitmap visited(n), frontierBits(n);
+    CsrGraph in;
+    bool haveTranspose = false;
+    std::vector<std::vector<int>> nextBy(pool.size());
+    std::vector<int> frontier{start}, ord{start};
+    std::vector<long long> scannedBy(pool.size());
+    visited.set(start);
+
+    long long unexplored = g.edgeCount();
+    bool bottomUp = false;
 
-                distText.setString(dStr);
+    while (!frontier.empty()) {
+        long long frontierEdges = 0;
+        for (int u : frontier) frontierEdges += g.offsets[u + 1] - g.offsets[u];
+        if (!bottomUp && frontierEdges > unexplored / alpha) {
+            bottomUp = true;
+        } else if (bottomUp && (long long)frontier.size() < n / beta) {
+            bottomUp = false;
+        }
+        unexplored -= frontierEdges;
 
-                sf::FloatRect distRect = distText.getLocalBounds();
-                distText.setOrigin({distRect.position.x + distRect.size.x / 2.0f,
-                                    distRect.position.y + distRect.size.y / 2.0f});
-                distText.setPosition(pos[i] + sf::Vector2f(0.f, radius + 12.f));
-                window.draw(distText);
+        for (auto& next : nextBy) next.clear();
+        if (bottomUp) {
+            if (!haveTranspose) {
+                in = transposeCsr(g);
+                haveTranspose = true;
+            }
+            frontierBits.clear();
+            for (int u : frontier) frontierBits.set(u);
+            pool.parallelFor(0, n, 4096, [&](long long lo, long long hi, unsigned worker) {
+                long long scanned = 0;
+                for (long long v = lo; v < hi; ++v) {
+                    if (visited.test((int)v)) continue;
+                    for (long long e = in.offsets[v]; e < in.offsets[v + 1]; ++e) {
+                        int u = in.targets[e];
+                        if (frontierBits.test(u)) {
+                            scanned += e - in.offsets[v];
+                            parent[v] = u;
+                            nextBy[worker].push_back((int)v);
+                            break;
+                        }
+                    }
+                    if (parent[v] == -1) scanned += in.offsets[v + 1] - in.offsets[v];
+                }
+                GV_COUNT(EdgesScanned, scanned);
+            });
+            for (auto& next : nextBy) {
+                for (int v : next) visited.set(v);
             }
+        } else {
+            pool.parallelFor(0, (long long)frontier.size(), 256, [&](long long lo, long long hi, unsigned worker) {
+                for (long long i = lo; i < hi; ++i) {
+                    int u = frontier[i];
+                    GV_COUNT(EdgesScanned, g.offsets[u + 1] - g.offsets[u]);
+                    for (long long e = g.offsets[u]; e < g.offsets[u + 1]; ++e) {
+                        int v = g.targets[e];
+                        if (!visited.test(v) && visited.claim(v)) {
+                            parent[v] = u;
+                            nextBy[worker].push_back(v);
+                        }
+                    }
+                }
+            });
         }
 
-        window.draw(titleText);
-        window.draw(infoText);
-        window.draw(statusText);
-        window.display();
+        GV_COUNT(NodesSettled, frontier.size());
+        frontier.clear();
+        for (auto& next : nextBy) frontier.insert(frontier.end(), next.begin(), next.end());
+        GV_COUNT(Relaxations, frontier.size());
+        std::sort(frontier.begin(), frontier.end());
+        ord.insert(ord.end(), frontier.begin(), frontier.end());
     }
+    return ord;
 }
 
-void runGraphAlgorithms() {
-    int n;
-    std::cout << "Enter number of nodes (max 10 recommended): ";
-    if (!(std::cin >> n) || n <= 0) {
-        std::cerr << "Invalid number\n";
-        return;
-    }
+template <int Arity>
+class IndexedDaryHeap {
+public:
+    explicit IndexedDaryHeap(int n) : pos(n, -1), keys(n, LLONG_MAX) {}
 
-    std::vector<std::vector<int>> graph(n, std::vector<int>(n));
-    std::cout << "Enter adjacency matrix (" << n << "x" << n << "), 0 for no edge:\n";
-    std::cout << "(Use negative numbers for Bellman-Ford)\n";
-    for (int i = 0; i < n; ++i)
-        for (int j = 0; j < n; ++j)
-            std::cin >> graph[i][j];
+    bool empty() const { return heap.empty(); }
+    bool contains(int v) const { return pos[v] != -1; }
+    int top() const { return heap[0]; }
+    long long topKey() const { return keys[heap[0]]; }
 
-    std::vector<sf::Vector2f> pos(n);
-    float cx = 400.f, cy = 300.f, R = 200.f;
-    for (int i = 0; i < n; ++i) {
-        float ang = i * 2.f * 3.14159265f / std::max(1, n);
-        pos[i] = sf::Vector2f(cx + R * std::cos(ang), cy + R * std::sin(ang));
+    void push(int v, long long key) {
+        GV_COUNT(HeapPushes, 1);
+        keys[v] = key;
+        pos[v] = (int)heap.size();
+        heap.push_back(v);
+        siftUp(pos[v]);
     }
 
-    std::cout << "Choose algorithm:\n1. Dijkstra\n2. BFS\n3. Bellman-Ford\n4. MST (Prim's)\n5. A* Search\n> ";
-    int ch; std::cin >> ch;
+    void decreaseKey(int v, long long key) {
+        GV_COUNT(HeapDecreaseKeys, 1);
+        keys[v] = key;
+        siftUp(pos[v]);
+    }
 
-    std::vector<int> parent(n, -1);
-    std::vector<int> order;
-    std::string title;
-    bool isShortestPathAlgo = false;
-    std::vector<long long> dist(n, LLONG_MAX);
-    long long totalCost = 0;
-    int destIndex = -1;
+    void clear() {
+        for (int v : heap) pos[v] = -1;
+        heap.clear();
+    }
 
-    if (ch == 1) {
-        order = dijkstraOrder(graph, parent, dist, 0);
-        title = "Dijkstra Visualization";
-        isShortestPathAlgo = true;
-    } else if (ch == 2) {
-        order = bfsOrder(graph, parent, 0);
-        title = "BFS Visualization";
-        isShortestPathAlgo = true;
-    } else if (ch == 3) {
-        bool hasNegativeCycle = bellmanFord(graph, parent, dist, 0);
-
-        if (hasNegativeCycle) {
-            std::cout << "\n\n*** WARNING: Negative weight cycle detected! ***\n";
-            std::cout << "Shortest paths are not well-defined.\n\n";
-        }
-
-        for (int i = 0; i < n; ++i) {
-            if (dist[i] != LLONG_MAX) {
-                order.push_back(i);
-            }
-        }
-        title = "Bellman-Ford Visualization";
-        isShortestPathAlgo = true;
-    } else if (ch == 4) {
-        order = mstPrimsOrder(graph, parent, 0);
-        title = "Prim's MST Visualization";
-        isShortestPathAlgo = false;
-        for (int i = 0; i < n; ++i) {
-            if (parent[i] != -1) {
-                totalCost += graph[parent[i]][i];
-            }
-        }
-    } else if (ch == 5) {
-        title = "A* Search Visualization";
-        isShortestPathAlgo = true;
-        std::cout << "A* Search requires a destination.\n";
-        std::cout << "Enter destination node (1-" << n << "): ";
-        int destNode;
-        if (!(std::cin >> destNode) || destNode < 1 || destNode > n) {
-            std::cerr << "Invalid destination node.\n";
-            return;
+    int pop() {
+        GV_COUNT(HeapPops, 1);
+        int top = heap[0];
+        int last = heap.back();
+        heap.pop_back();
+        pos[top] = -1;
+        if (!heap.empty()) {
+            heap[0] = last;
+            pos[last] = 0;
+            siftDown(0);
         }
-        destIndex = destNode - 1;
-        order = aStarOrder(graph, parent, dist, pos, 0, destIndex);
-    } else {
-        std::cerr << "Invalid choice\n";
-        return;
+        return top;
     }
 
+private:
+    std::vector<int> heap;
+    std::vector<int> pos;
+    std::vector<long long> keys;
 
-    std::set<std::pair<int, int>> shortestPathEdges;
+    bool less(int a, int b) const {
+        return keys[a] < keys[b] || (keys[a] == keys[b] && a < b);
+    }
 
-    if (isShortestPathAlgo && destIndex == -1) {
-        std::cout << "Enter destination node (1-" << n << ") to highlight path (0 for none): ";
-        int destNode;
-        std::cin >> destNode;
-        destIndex = destNode - 1;
+    void siftUp(int i) {
+        int v = heap[i];
+        while (i > 0) {
+            int p = (i - 1) / Arity;
+            if (!less(v, heap[p])) break;
+            heap[i] = heap[p];
+            pos[heap[i]] = i;
+            i = p;
+        }
+        heap[i] = v;
+        pos[v] = i;
     }
 
-    if (isShortestPathAlgo && destIndex >= 0) {
-        if (destIndex < n && (parent[destIndex] != -1 || destIndex == 0) ) {
-            int curr = destIndex;
-            while (parent[curr] != -1) {
-                shortestPathEdges.insert({parent[curr], curr});
-                curr = parent[curr];
+    void siftDown(int i) {
+        int v = heap[i];
+        int size = (int)heap.size();
+        while (true) {
+            int first = i * Arity + 1;
+            if (first >= size) break;
+            int best = first;
+            int end = std::min(first + Arity, size);
+            for (int c = first + 1; c < end; ++c) {
+                if (less(heap[c], heap[best])) best = c;
             }
-        } else if (destIndex != 0) {
-            std::cout << "Node " << (destIndex + 1) << " is not reachable from node 1.\n";
+            if (!less(heap[best], v)) break;
+            heap[i] = heap[best];
+            pos[heap[i]] = i;
+            i = best;
         }
+        heap[i] = v;
+        pos[v] = i;
     }
+};
 
+using IndexedBinaryHeap = IndexedDaryHeap<2>;
+using IndexedQuaternaryHeap = IndexedDaryHeap<4>;
 
-    std::cout << "\nTraversal/Visit order: ";
-    for (size_t i = 0; i < order.size(); ++i) {
-        std::cout << (order[i] + 1);
-        if (i + 1 < order.size()) std::cout << " -> ";
-    }
-    std::cout << "\n\nVisited nodes (step by step):\n";
-    for (auto v : order) std::cout << "Node " << (v+1) << "\n";
+// Monotone heap for non-negative integer keys: a popped key is never larger than any later key.
+class IndexedRadixHeap {
+public:
+    explicit IndexedRadixHeap(int n) : pos(n, -1), bucketOf(n, -1), keys(n, 0) {}
 
-    visualizeGraph(graph, order, parent, shortestPathEdges, dist, pos, title, destIndex, totalCost);
-}
+    bool empty() const { return count == 0; }
+    bool contains(int v) const { return pos[v] != -1; }
 
-struct HuffmanNode {
-    char data;
-    unsigned freq;
-    HuffmanNode *left, *right;
+    void push(int v, long long key) {
+        GV_COUNT(HeapPushes, 1);
+        keys[v] = key;
+        insert(v);
+        count++;
+    }
 
-    HuffmanNode(char data, unsigned freq) : data(data), freq(freq), left(nullptr), right(nullptr) {}
-};
+    void decreaseKey(int v, long long key) {
+        GV_COUNT(HeapDecreaseKeys, 1);
+        erase(v);
+        keys[v] = key;
+        insert(v);
+    }
 
-struct compare {
-    bool operator()(HuffmanNode* l, HuffmanNode* r) {
-        return (l->freq > r->freq);
+    int pop() {
+        GV_COUNT(HeapPops, 1);
+        if (buckets[0].empty()) {
+            int b = 1;
+            while (buckets[b].empty()) b++;
+            long long minKey = LLONG_MAX;
+            for (int v : buckets[b]) minKey = std::min(minKey, keys[v]);
+            last = minKey;
+            std::vector<int> moved;
+            moved.swap(buckets[b]);
+            for (int v : moved) insert(v);
+        }
+        int v = buckets[0].back();
+        buckets[0].pop_back();
+        pos[v] = -1;
+        bucketOf[v] = -1;
+        count--;
+        return v;
     }
-};
 
-HuffmanNode* buildHuffmanTree(std::map<char, unsigned>& freqMap) {
-    std::priority_queue<HuffmanNode*, std::vector<HuffmanNode*>, compare> minHeap;
+private:
+    std::vector<int> buckets[65];
+    std::vector<int> pos;
+    std::vector<int> bucketOf;
+    std::vector<long long> keys;
+    long long last = 0;
+    int count = 0;
 
-    for (auto pair : freqMap) {
-        minHeap.push(new HuffmanNode(pair.first, pair.second));
+    int bucketFor(long long key) const {
+        return (int)std::bit_width((unsigned long long)(key ^ last));
     }
 
-    while (minHeap.size() > 1) {
-        HuffmanNode* left = minHeap.top(); minHeap.pop();
-        HuffmanNode* right = minHeap.top(); minHeap.pop();
+    void insert(int v) {
+        int b = bucketFor(keys[v]);
+        bucketOf[v] = b;
+        pos[v] = (int)buckets[b].size();
+        buckets[b].push_back(v);
+    }
 
-        HuffmanNode* top = new HuffmanNode('$', left->freq + right->freq);
-        top->left = left;
-        top->right = right;
-        minHeap.push(top);
+    void erase(int v) {
+        std::vector<int>& bucket = buckets[bucketOf[v]];
+        int moved = bucket.back();
+        bucket[pos[v]] = moved;
+        pos[moved] = pos[v];
+        bucket.pop_back();
+        pos[v] = -1;
     }
-    return minHeap.top();
-}
+};
 
-void generateCodes(HuffmanNode* root, std::string str, std::map<char, std::string>& codes) {
-    if (!root) return;
+enum class HeapKind { Binary, Quaternary, Radix };
 
-    if (root->data != '$') {
-        codes[root->data] = str;
+bool hasNegativeWeights(const CsrGraph& g) {
+    for (int w : g.weights) {
+        if (w < 0) return true;
     }
-    generateCodes(root->left, str + "0", codes);
-    generateCodes(root->right, str + "1", codes);
+    return false;
 }
 
-std::string decodeHuffman(HuffmanNode* root, std::string s) {
-    std::string ans = "";
-    HuffmanNode* curr = root;
-    for (int i=0; i<s.length(); i++) {
-        if (s[i] == '0')
-           curr = curr->left;
-        else
-           curr = curr->right;
+template <typename Heap>
+std::vector<int> dijkstraWithHeap(const CsrGraph& g, std::vector<int>& parent,
+                                  std::vector<long long>& dist, int start, EventRing* trace) {
+    int n = g.n;
+    dist.assign(n, LLONG_MAX);
+    std::vector<int> vis(n, 0), ord;
+    parent.assign(n, -1);
+
+    Heap heap(n);
+    dist[start] = 0;
+    heap.push(start, 0);
+    traceEvent(trace, TraceKind::Relax, start, -1, 0);
+    traceEvent(trace, TraceKind::Push, start, -1, 0);
+
+    while (!heap.empty()) {
+        int u = heap.pop();
+        traceEvent(trace, TraceKind::Pop, u, -1, dist[u]);
+        vis[u] = 1;
+        ord.push_back(u);
+        traceEvent(trace, TraceKind::Visit, u, parent[u], dist[u]);
+        GV_COUNT(NodesSettled, 1);
+        GV_COUNT(EdgesScanned, g.offsets[u + 1] - g.offsets[u]);
 
-        if (curr->left == nullptr && curr->right == nullptr) {
-            ans += curr->data;
-            curr = root;
+        for (long long e = g.offsets[u]; e < g.offsets[u + 1]; ++e) {
+            int v = g.targets[e];
+            if (dist[u] + g.weights[e] < dist[v]) {
+                GV_COUNT(Relaxations, 1);
+                dist[v] = dist[u] + g.weights[e];
+                parent[v] = u;
+                traceEvent(trace, TraceKind::Relax, v, u, dist[v]);
+                if (vis[v]) continue;
+                if (heap.contains(v)) heap.decreaseKey(v, dist[v]);
+                else heap.push(v, dist[v]);
+                traceEvent(trace, TraceKind::Push, v, -1, dist[v]);
+            }
         }
     }
-    return ans;
+    return ord;
 }
 
-void deleteTree(HuffmanNode* node) {
-    if (node == nullptr) return;
-    deleteTree(node->left);
-    deleteTree(node->right);
-    delete node;
+std::vector<int> dijkstraOrder(const CsrGraph& g, std::vector<int>& parent,
+                               std::vector<long long>& dist, int start = 0,
+                               HeapKind heapKind = HeapKind::Quaternary, EventRing* trace = nullptr) {
+    if (heapKind == HeapKind::Radix && !hasNegativeWeights(g)) {
+        return dijkstraWithHeap<IndexedRadixHeap>(g, parent, dist, start, trace);
+    }
+    if (heapKind == HeapKind::Binary) {
+        return dijkstraWithHeap<IndexedBinaryHeap>(g, parent, dist, start, trace);
+    }
+    return dijkstraWithHeap<IndexedQuaternaryHeap>(g, parent, dist, start, trace);
+}
+
+const int kDeltaSteppingMinVertices = 4096;
+
+struct RelaxRequest {
+    int v;
+    int from;
+    long long dist;
+};
+
+long long defaultDelta(const CsrGraph& g) {
+    int maxWeight = 1;
+    for (int w : g.weights) maxWeight = std::max(maxWeight, w);
+    long long avgDegree = std::max(1LL, g.edgeCount() / std::max(1, g.n));
+    return std::max(1LL, maxWeight / avgDegree);
+}
+
+std::vector<int> deltaSteppingOrder(const CsrGraph& g, std::vector<int>& parent,
+                                    std::vector<long long>& dist, int start = 0, long long delta = 0,
+                                    ThreadPool& pool = sharedThreadPool()) {
+    if (g.n < kDeltaSteppingMinVertices || pool.size() == 1 || hasNegativeWeights(g)) {
+        return dijkstraOrder(g, parent, dist, start);
+    }
+    int n = g.n;
+    if (delta <= 0) delta = defaultDelta(g);
+    dist.assign(n, LLONG_MAX);
+    parent.assign(n, -1);
+
+    int maxWeight = 0;
+    for (int w : g.weights) maxWeight = std::max(maxWeight, w);
+    size_t bucketCount = (size_t)(maxWeight / delta) + 2;
+    std::vector<std::vector<int>> buckets(bucketCount);
+    std::vector<long long> frontierStamp(n, -1), settledStamp(n, -1);
+    std::vector<std::vector<RelaxRequest>> requests(pool.size());
+    std::vector<int> ord;
+    size_t pending = 1;
+
+    dist[start] = 0;
+    buckets[0].push_back(start);
+
+    auto relax = [&](const std::vector<int>& sources, bool light) {
+        for (auto& r : requests) r.clear();
+        pool.parallelFor(0, (long long)sources.size(), 64, [&](long long lo, long long hi, unsigned worker) {
+            std::vector<RelaxRequest>& out = requests[worker];
+            for (long long i = lo; i < hi; ++i) {
+                int u = sources[i];
+                GV_COUNT(EdgesScanned, g.offsets[u + 1] - g.offsets[u]);
+                for (long long e = g.offsets[u]; e < g.offsets[u + 1]; ++e) {
+                    int w = g.weights[e];
+                    if ((w <= delta) != light) continue;
+                    long long nd = dist[u] + w;
+                    if (nd < dist[g.targets[e]]) out.push_back({g.targets[e], u, nd});
+                }
+            }
+        });
+        for (auto& out : requests) {
+            for (const RelaxRequest& r : out) {
+                if (r.dist < dist[r.v]) {
+                    GV_COUNT(Relaxations, 1);
+                    dist[r.v] = r.dist;
+                    parent[r.v] = r.from;
+                    buckets[(size_t)(r.dist / delta) % bucketCount].push_back(r.v);
+                    pending++;
+                }
+            }
+        }
+    };
+
+    long long phase = 0;
+    for (long long i = 0; pending > 0; ++i) {
+        std::vector<int>& bucket = buckets[(size_t)i % bucketCount];
+        std::vector<int> settled;
+        while (!bucket.empty()) {
+            std::vector<int> frontier;
+            frontier.swap(bucket);
+            pending -= frontier.size();
+            phase++;
+            size_t kept = 0;
+            for (int v : frontier) {
+                if (dist[v] / delta != i || frontierStamp[v] == phase) continue;
+                frontierStamp[v] = phase;
+                frontier[kept++] = v;
+                if (settledStamp[v] != i) {
+                    settledStamp[v] = i;
+                    settled.push_back(v);
+                }
+            }
+            frontier.resize(kept);
+            relax(frontier, true);
+        }
+        relax(settled, false);
+        GV_COUNT(NodesSettled, settled.size());
+        std::sort(settled.begin(), settled.end(), [&](int a, int b) {
+            return dist[a] < dist[b] || (dist[a] == dist[b] && a < b);
+        });
+        ord.insert(ord.end(), settled.begin(), settled.end());
+    }
+    return ord;
+}
+
+enum class BellmanFordMode { Queue, Rounds, Parallel };
+
+bool bellmanFordRounds(const CsrGraph& g, std::vector<int>& parent,
+                       std::vector<long long>& dist, int start, EventRing* trace = nullptr) {
+    int n = g.n;
+    dist.assign(n, LLONG_MAX);
+    parent.assign(n, -1);
+
+    dist[start] = 0;
+    traceEvent(trace, TraceKind::Relax, start, -1, 0);
+
+    for (int i = 1; i <= n - 1; ++i) {
+        bool changed = false;
+        for (int u = 0; u < n; ++u) {
+            if (dist[u] == LLONG_MAX) continue;
+            GV_COUNT(NodesSettled, 1);
+            GV_COUNT(EdgesScanned, g.offsets[u + 1] - g.offsets[u]);
+            for (long long e = g.offsets[u]; e < g.offsets[u + 1]; ++e) {
+                int v = g.targets[e];
+                int weight = g.weights[e];
+                if (dist[u] + weight < dist[v]) {
+                    GV_COUNT(Relaxations, 1);
+                    dist[v] = dist[u] + weight;
+                    parent[v] = u;
+                    traceEvent(trace, TraceKind::Relax, v, u, dist[v]);
+                    changed = true;
+                }
+            }
+        }
+        if (!changed) return false;
+    }
+
+    for (int u = 0; u < n; ++u) {
+        if (dist[u] == LLONG_MAX) continue;
+        for (long long e = g.offsets[u]; e < g.offsets[u + 1]; ++e) {
+            if (dist[u] + g.weights[e] < dist[g.targets[e]]) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+// SPFA: only out-edges of vertices whose distance changed are relaxed. A shortest path
+// that needs n or more edges can only exist when a negative cycle is reachable.
+bool bellmanFordQueue(const CsrGraph& g, std::vector<int>& parent,
+                      std::vector<long long>& dist, int start, EventRing* trace = nullptr) {
+    int n = g.n;
+    dist.assign(n, LLONG_MAX);
+    parent.assign(n, -1);
+    std::vector<int> pathEdges(n, 0);
+    std::vector<char> inQueue(n, 0);
+    std::queue<int> q;
+
+    dist[start] = 0;
+    q.push(start);
+    inQueue[start] = 1;
+    traceEvent(trace, TraceKind::Relax, start, -1, 0);
+    traceEvent(trace, TraceKind::Push, start, -1, 0);
+
+    while (!q.empty()) {
+        int u = q.front(); q.pop();
+        inQueue[u] = 0;
+        traceEvent(trace, TraceKind::Pop, u, -1, dist[u]);
+        GV_COUNT(NodesSettled, 1);
+        GV_COUNT(EdgesScanned, g.offsets[u + 1] - g.offsets[u]);
+        for (long long e = g.offsets[u]; e < g.offsets[u + 1]; ++e) {
+            int v = g.targets[e];
+            if (dist[u] + g.weights[e] < dist[v]) {
+                GV_COUNT(Relaxations, 1);
+                dist[v] = dist[u] + g.weights[e];
+                parent[v] = u;
+                traceEvent(trace, TraceKind::Relax, v, u, dist[v]);
+                pathEdges[v] = pathEdges[u] + 1;
+                if (pathEdges[v] >= n) {
+                    return bellmanFordRounds(g, parent, dist, start, trace);
+                }
+                if (!inQueue[v]) {
+                    inQueue[v] = 1;
+                    q.push(v);
+                    traceEvent(trace, TraceKind::Push, v, -1, dist[v]);
+                }
+            }
+        }
+    }
+    return false;
+}
+
+// Jacobi-style rounds that pull over in-edges, so every vertex is written by one thread only.
+bool bellmanFordParallel(const CsrGraph& g, std::vector<int>& parent,
+                         std::vector<long long>& dist, int start,
+                         ThreadPool& pool = sharedThreadPool()) {
+    int n = g.n;
+    CsrGraph in = transposeCsr(g);
+    dist.assign(n, LLONG_MAX);
+    parent.assign(n, -1);
+    std::vector<long long> next(n);
+    std::vector<char> changedBy(pool.size());
+
+    dist[start] = 0;
+
+    for (int round = 1; round <= n; ++round) {
+        std::fill(changedBy.begin(), changedBy.end(), 0);
+        pool.parallelFor(0, n, 1024, [&](long long lo, long long hi, unsigned worker) {
+            long long relaxed = 0;
+            for (long long v = lo; v < hi; ++v) {
+                long long best = dist[v];
+                for (long long e = in.offsets[v]; e < in.offsets[v + 1]; ++e) {
+                    int u = in.targets[e];
+                    if (dist[u] != LLONG_MAX && dist[u] + in.weights[e] < best) {
+                        best = dist[u] + in.weights[e];
+                        parent[v] = u;
+                        relaxed++;
+                    }
+                }
+                if (best != dist[v]) changedBy[worker] = 1;
+                next[v] = best;
+            }
+            GV_COUNT(NodesSettled, hi - lo);
+            GV_COUNT(EdgesScanned, in.offsets[hi] - in.offsets[lo]);
+            GV_COUNT(Relaxations, relaxed);
+        });
+        dist.swap(next);
+        bool changed = std::find(changedBy.begin(), changedBy.end(), 1) != changedBy.end();
+        if (!changed) return false;
+    }
+    return true;
+}
+
+bool bellmanFord(const CsrGraph& g, std::vector<int>& parent,
+                 std::vector<long long>& dist, int start = 0,
+                 BellmanFordMode mode = BellmanFordMode::Queue, EventRing* trace = nullptr) {
+    if (mode == BellmanFordMode::Rounds) return bellmanFordRounds(g, parent, dist, start, trace);
+    if (mode == BellmanFordMode::Parallel) return bellmanFordParallel(g, parent, dist, start);
+    return bellmanFordQueue(g, parent, dist, start, trace);
+}
+
+struct UnionFind {
+    std::vector<int> parent;
+    std::vector<int> rank;
+
+    explicit UnionFind(int n) : parent(n), rank(n, 0) {
+        for (int i = 0; i < n; ++i) parent[i] = i;
+    }
+
+    int find(int x) {
+        while (parent[x] != x) {
+            parent[x] = parent[parent[x]];
+            x = parent[x];
+        }
+        return x;
+    }
+
+    bool unite(int a, int b) {
+        a = find(a);
+        b = find(b);
+        if (a == b) return false;
+        if (rank[a] < rank[b]) std::swap(a, b);
+        parent[b] = a;
+        if (rank[a] == rank[b]) rank[a]++;
+        return true;
+    }
+};
+
+struct UndirectedEdge {
+    int w;
+    int a;
+    int b;
+};
+
+// MST engines treat the graph as undirected and, like Prim's, ignore non-positive weights.
+std::vector<UndirectedEdge> undirectedEdges(const CsrGraph& g) {
+    std::vector<UndirectedEdge> edges;
+    for (int u = 0; u < g.n; ++u) {
+        for (long long e = g.offsets[u]; e < g.offsets[u + 1]; ++e) {
+            int v = g.targets[e];
+            if (g.weights[e] <= 0 || u == v) continue;
+            if (u < v) edges.push_back({g.weights[e], u, v});
+            else edges.push_back({g.weights[e], v, u});
+        }
+    }
+    return edges;
+}
+
+// Orients the forest away from the lowest-numbered vertex of each tree. The order lists the roots,
+// then the child end of each tree edge in the order the edges were accepted.
+std::vector<int> rootForest(int n, const std::vector<UndirectedEdge>& treeEdges, std::vector<int>& parent) {
+    std::vector<int> degree(n + 1, 0);
+    for (const auto& e : treeEdges) {
+        degree[e.a + 1]++;
+        degree[e.b + 1]++;
+    }
+    for (int v = 0; v < n; ++v) degree[v + 1] += degree[v];
+    std::vector<int> nbr(degree[n]);
+    std::vector<int> fill(degree.begin(), degree.end() - 1);
+    for (const auto& e : treeEdges) {
+        nbr[fill[e.a]++] = e.b;
+        nbr[fill[e.b]++] = e.a;
+    }
+
+    parent.assign(n, -1);
+    std::vector<char> seen(n, 0);
+    std::vector<int> ord, stack;
+    for (int root = 0; root < n; ++root) {
+        if (seen[root]) continue;
+        seen[root] = 1;
+        ord.push_back(root);
+        stack.push_back(root);
+        while (!stack.empty()) {
+            int u = stack.back(); stack.pop_back();
+            for (int i = degree[u]; i < degree[u + 1]; ++i) {
+                int v = nbr[i];
+                if (seen[v]) continue;
+                seen[v] = 1;
+                parent[v] = u;
+                stack.push_back(v);
+            }
+        }
+    }
+    for (const auto& e : treeEdges) {
+        ord.push_back(parent[e.b] == e.a ? e.b : e.a);
+    }
+    return ord;
+}
+
+// Runs over the same symmetrized edge set as Kruskal and Boruvka, so all three agree on directed input.
+std::vector<int> mstPrimsOrder(const CsrGraph& input, std::vector<int>& parent, long long& totalCost, int start = 0,
+                               EventRing* trace = nullptr) {
+    int n = input.n;
+    std::vector<WeightedEdge> both;
+    for (const auto& e : undirectedEdges(input)) {
+        both.push_back({e.a, e.b, e.w});
+        both.push_back({e.b, e.a, e.w});
+    }
+    CsrGraph g = csrFromEdges(n, both);
+    both = {};
+    std::vector<long long> key(n, LLONG_MAX);
+    std::vector<bool> inMST(n, false);
+    std::vector<int> ord;
+    IndexedQuaternaryHeap heap(n);
+    parent.assign(n, -1);
+    totalCost = 0;
+
+    for (int r = -1; r < n; ++r) {
+        int root = (r < 0) ? start : r;
+        if (inMST[root]) continue;
+        key[root] = 0;
+        heap.push(root, 0);
+        traceEvent(trace, TraceKind::Push, root, -1, 0);
+
+        while (!heap.empty()) {
+            int u = heap.pop();
+            traceEvent(trace, TraceKind::Pop, u, -1, key[u]);
+            inMST[u] = true;
+            ord.push_back(u);
+            traceEvent(trace, TraceKind::Visit, u, parent[u], key[u]);
+            totalCost += key[u];
+            GV_COUNT(NodesSettled, 1);
+            GV_COUNT(EdgesScanned, g.offsets[u + 1] - g.offsets[u]);
+
+            for (long long e = g.offsets[u]; e < g.offsets[u + 1]; ++e) {
+                int v = g.targets[e];
+                if (!inMST[v] && g.weights[e] < key[v]) {
+                    GV_COUNT(Relaxations, 1);
+                    parent[v] = u;
+                    key[v] = g.weights[e];
+                    traceEvent(trace, TraceKind::Relax, v, u, key[v]);
+                    if (heap.contains(v)) heap.decreaseKey(v, key[v]);
+                    else heap.push(v, key[v]);
+                    traceEvent(trace, TraceKind::Push, v, -1, key[v]);
+                }
+            }
+        }
+    }
+    return ord;
+}
+
+std::vector<int> mstKruskalOrder(const CsrGraph& g, std::vector<int>& parent, long long& totalCost) {
+    std::vector<UndirectedEdge> edges = undirectedEdges(g);
+    std::sort(edges.begin(), edges.end(), [](const UndirectedEdge& x, const UndirectedEdge& y) {
+        if (x.w != y.w) return x.w < y.w;
+        if (x.a != y.a) return x.a < y.a;
+        return x.b < y.b;
+    });
+
+    UnionFind uf(g.n);
+    std::vector<UndirectedEdge> tree;
+    totalCost = 0;
+    size_t scanned = 0;
+    for (const auto& e : edges) {
+        scanned++;
+        if (uf.unite(e.a, e.b)) {
+            tree.push_back(e);
+            totalCost += e.w;
+            if ((int)tree.size() == g.n - 1) break;
+        }
+    }
+    GV_COUNT(EdgesScanned, scanned);
+    GV_COUNT(Relaxations, tree.size());
+    return rootForest(g.n, tree, parent);
+}
+
+std::vector<int> mstBoruvkaOrder(const CsrGraph& g, std::vector<int>& parent, long long& totalCost,
+                                 ThreadPool& pool = sharedThreadPool()) {
+    int n = g.n;
+    std::vector<UndirectedEdge> edges = undirectedEdges(g);
+    std::vector<std::atomic<unsigned long long>> cheapest(n);
+    std::vector<int> comp(n);
+    for (int v = 0; v < n; ++v) comp[v] = v;
+
+    UnionFind uf(n);
+    std::vector<UndirectedEdge> tree;
+    totalCost = 0;
+
+    auto offer = [](std::atomic<unsigned long long>& slot, unsigned long long candidate) {
+        unsigned long long cur = slot.load(std::memory_order_relaxed);
+        while (candidate < cur && !slot.compare_exchange_weak(cur, candidate, std::memory_order_relaxed)) {}
+    };
+
+    while (true) {
+        pool.parallelFor(0, n, 4096, [&](long long lo, long long hi, unsigned) {
+            for (long long v = lo; v < hi; ++v) cheapest[v].store(ULLONG_MAX, std::memory_order_relaxed);
+        });
+        // Keys are (weight, edge index) so ties break consistently and no cycle can be formed.
+        GV_COUNT(EdgesScanned, edges.size());
+        pool.parallelFor(0, (long long)edges.size(), 8192, [&](long long lo, long long hi, unsigned) {
+            for (long long i = lo; i < hi; ++i) {
+                int ca = comp[edges[i].a], cb = comp[edges[i].b];
+                if (ca == cb) continue;
+                unsigned long long candidate = ((unsigned long long)edges[i].w << 32) | (unsigned long long)i;
+                offer(cheapest[ca], candidate);
+                offer(cheapest[cb], candidate);
+            }
+        });
+
+        size_t before = tree.size();
+        for (int c = 0; c < n; ++c) {
+            unsigned long long best = cheapest[c].load(std::memory_order_relaxed);
+            if (best == ULLONG_MAX) continue;
+            const UndirectedEdge& e = edges[best & 0xffffffffULL];
+            if (uf.unite(e.a, e.b)) {
+                tree.push_back(e);
+                totalCost += e.w;
+            }
+        }
+        GV_COUNT(Relaxations, tree.size() - before);
+        if (tree.size() == before) break;
+        for (int v = 0; v < n; ++v) comp[v] = uf.find(v);
+    }
+    return rootForest(n, tree, parent);
+}
+
+float heuristic(int nodeA, int nodeB, const std::vector<sf::Vector2f>& pos) {
+    sf::Vector2f dir = pos[nodeB] - pos[nodeA];
+    return std::sqrt(dir.x * dir.x + dir.y * dir.y);
+}
+
+// Johnson potentials: distances from a virtual source tied to every vertex by a zero-weight
+// edge. Reweighting w(u,v) + h[u] - h[v] makes every edge non-negative without changing which
+// paths are shortest. Returns false on a negative cycle.
+bool johnsonPotentials(const CsrGraph& g, std::vector<long long>& h) {
+    GV_TIME(Preprocess);
+    int n = g.n;
+    h.assign(n, 0);
+    if (!hasNegativeWeights(g)) return true;
+    std::vector<int> pathEdges(n, 0);
+    std::vector<char> inQueue(n, 1);
+    std::queue<int> q;
+    for (int v = 0; v < n; ++v) q.push(v);
+    while (!q.empty()) {
+        int u = q.front(); q.pop();
+        inQueue[u] = 0;
+        GV_COUNT(NodesSettled, 1);
+        GV_COUNT(EdgesScanned, g.offsets[u + 1] - g.offsets[u]);
+        for (long long e = g.offsets[u]; e < g.offsets[u + 1]; ++e) {
+            int v = g.targets[e];
+            if (h[u] + g.weights[e] < h[v]) {
+                GV_COUNT(Relaxations, 1);
+                h[v] = h[u] + g.weights[e];
+                pathEdges[v] = pathEdges[u] + 1;
+                if (pathEdges[v] >= n) return false;
+                if (!inQueue[v]) {
+                    inQueue[v] = 1;
+                    q.push(v);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// Landmark distances are taken over Johnson-reweighted weights, so Dijkstra computes them exactly even
+// when the graph has negative edges; `potential` shifts a bound back to the original weights.
+struct Landmarks {
+    std::vector<int> nodes;
+    std::vector<long long> potential;
+    std::vector<std::vector<long long>> fromLandmark;
+    std::vector<std::vector<long long>> toLandmark;
+};
+
+// Farthest-point selection: each new landmark is the reachable vertex farthest from the ones chosen so far.
+// A negative cycle, or reweighted weights past int range, leave no landmarks and only the potential bound.
+Landmarks selectLandmarks(const CsrGraph& input, int count, ThreadPool& pool = sharedThreadPool()) {
+    GV_TIME(Preprocess);
+    Landmarks lm;
+    if (input.n == 0) return lm;
+    if (!johnsonPotentials(input, lm.potential)) {
+        lm.potential.assign(input.n, 0);
+        return lm;
+    }
+    CsrGraph g = input;
+    if (hasNegativeWeights(input)) {
+        CsrArrays a;
+        a.offsets.assign(input.offsets.begin(), input.offsets.end());
+        a.targets.assign(input.targets.begin(), input.targets.end());
+        a.weights.resize(input.targets.size());
+        for (int u = 0; u < input.n; ++u) {
+            for (long long e = input.offsets[u]; e < input.offsets[u + 1]; ++e) {
+                long long w = input.weights[e] + lm.potential[u] - lm.potential[input.targets[e]];
+                if (w > INT_MAX) return lm;
+                a.weights[e] = (int)w;
+            }
+        }
+        g = makeCsrGraph(input.n, std::move(a));
+    }
+    std::vector<int> parent;
+    std::vector<long long> dist;
+    std::vector<long long> nearest(g.n, LLONG_MAX);
+
+    dijkstraOrder(g, parent, dist, 0);
+    int next = 0;
+    for (int v = 0; v < g.n; ++v) {
+        if (dist[v] != LLONG_MAX && dist[v] > dist[next]) next = v;
+    }
+
+    for (int k = 0; k < std::min(count, g.n); ++k) {
+        lm.nodes.push_back(next);
+        lm.fromLandmark.emplace_back();
+        dijkstraOrder(g, parent, lm.fromLandmark.back(), next);
+        const std::vector<long long>& d = lm.fromLandmark.back();
+        long long bestDist = -1;
+        next = -1;
+        for (int v = 0; v < g.n; ++v) {
+            if (d[v] != LLONG_MAX) nearest[v] = std::min(nearest[v], d[v]);
+            if (nearest[v] != LLONG_MAX && nearest[v] > bestDist) {
+                bestDist = nearest[v];
+                next = v;
+            }
+        }
+        if (next == -1 || bestDist == 0) break;
+    }
+
+    CsrGraph reverse = transposeCsr(g);
+    lm.toLandmark.resize(lm.nodes.size());
+    pool.parallelFor(0, (long long)lm.nodes.size(), 1, [&](long long lo, long long hi, unsigned) {
+        std::vector<int> p;
+        for (long long i = lo; i < hi; ++i) dijkstraOrder(reverse, p, lm.toLandmark[i], lm.nodes[i]);
+    });
+    return lm;
+}
+
+// Lower bounds on path length. Both kinds are consistent, so A* never has to reopen a closed node; on
+// graphs with negative weights that holds for the landmark kind only.
+struct AStarHeuristic {
+    enum class Kind { None, Euclidean, Landmark };
+
+    Kind kind = Kind::None;
+    const std::vector<sf::Vector2f>* pos = nullptr;
+    double scale = 0.0;
+    const Landmarks* landmarks = nullptr;
+
+    long long estimate(int v, int target) const {
+        if (kind == Kind::Euclidean) return (long long)(scale * heuristic(v, target, *pos));
+        if (kind == Kind::Landmark) return landmarkBound(v, target);
+        return 0;
+    }
+
+    long long estimateFrom(int source, int v) const {
+        if (kind == Kind::Euclidean) return (long long)(scale * heuristic(source, v, *pos));
+        if (kind == Kind::Landmark) return landmarkBound(source, v);
+        return 0;
+    }
+
+private:
+    long long landmarkBound(int from, int to) const {
+        if (landmarks->potential.empty()) return 0;
+        long long best = 0;
+        for (size_t i = 0; i < landmarks->nodes.size(); ++i) {
+            const std::vector<long long>& fl = landmarks->fromLandmark[i];
+            const std::vector<long long>& tl = landmarks->toLandmark[i];
+            if (fl[from] != LLONG_MAX && fl[to] != LLONG_MAX) best = std::max(best, fl[to] - fl[from]);
+            if (tl[from] != LLONG_MAX && tl[to] != LLONG_MAX) best = std::max(best, tl[from] - tl[to]);
+        }
+        return best - landmarks->potential[from] + landmarks->potential[to];
+    }
+};
+
+// Screen distance scaled by the smallest weight-per-pixel over all edges, which keeps it admissible.
+AStarHeuristic euclideanHeuristic(const CsrGraph& g, const std::vector<sf::Vector2f>& pos) {
+    AStarHeuristic h;
+    h.kind = AStarHeuristic::Kind::Euclidean;
+    h.pos = &pos;
+    h.scale = std::numeric_limits<double>::infinity();
+    for (int u = 0; u < g.n; ++u) {
+        for (long long e = g.offsets[u]; e < g.offsets[u + 1]; ++e) {
+            double len = heuristic(u, g.targets[e], pos);
+            if (len > 0.0) h.scale = std::min(h.scale, g.weights[e] / len);
+            else if (g.weights[e] <= 0) h.scale = 0.0;
+        }
+    }
+    if (!std::isfinite(h.scale) || h.scale < 0.0) h.scale = 0.0;
+    return h;
+}
+
+AStarHeuristic landmarkHeuristic(const Landmarks& landmarks) {
+    AStarHeuristic h;
+    h.kind = AStarHeuristic::Kind::Landmark;
+    h.landmarks = &landmarks;
+    return h;
+}
+
+std::vector<int> aStarOrder(const CsrGraph& g, std::vector<int>& parent,
+                            std::vector<long long>& gScore, const AStarHeuristic& h,
+                            int start, int dest, EventRing* trace = nullptr) {
+    int n = g.n;
+    gScore.assign(n, LLONG_MAX);
+    std::vector<char> closed(n, 0);
+    std::vector<int> ord;
+    parent.assign(n, -1);
+    IndexedQuaternaryHeap open(n);
+
+    gScore[start] = 0;
+    open.push(start, h.estimate(start, dest));
+    traceEvent(trace, TraceKind::Relax, start, -1, 0);
+    traceEvent(trace, TraceKind::Push, start, -1, h.estimate(start, dest));
+
+    while (!open.empty()) {
+        int u = open.pop();
+        traceEvent(trace, TraceKind::Pop, u, -1, gScore[u]);
+        closed[u] = 1;
+        ord.push_back(u);
+        traceEvent(trace, TraceKind::Visit, u, parent[u], gScore[u]);
+
+        GV_COUNT(NodesSettled, 1);
+        if (u == dest) break;
+
+        GV_COUNT(EdgesScanned, g.offsets[u + 1] - g.offsets[u]);
+        for (long long e = g.offsets[u]; e < g.offsets[u + 1]; ++e) {
+            int v = g.targets[e];
+            if (closed[v]) continue;
+            long long tentative_gScore = gScore[u] + g.weights[e];
+            if (tentative_gScore < gScore[v]) {
+                GV_COUNT(Relaxations, 1);
+                parent[v] = u;
+                gScore[v] = tentative_gScore;
+                traceEvent(trace, TraceKind::Relax, v, u, gScore[v]);
+                long long fScore = gScore[v] + h.estimate(v, dest);
+                if (open.contains(v)) open.decreaseKey(v, fScore);
+                else open.push(v, fScore);
+                traceEvent(trace, TraceKind::Push, v, -1, fScore);
+            }
+        }
+    }
+    return ord;
+}
+
+// Bidirectional A* with the averaged potential p(v) = (h(v, dest) - h(start, v)) / 2, kept doubled to stay
+// integral. Forward keys are 2g + 2p and reverse keys 2g - 2p; the search stops once their sum reaches twice
+// the best meeting cost. Only the forward tree and the final path get parents.
+std::vector<int> bidirectionalAStarOrder(const CsrGraph& g, const CsrGraph& reverse, std::vector<int>& parent,
+                                         std::vector<long long>& gScore, const AStarHeuristic& h,
+                                         int start, int dest) {
+    int n = g.n;
+    gScore.assign(n, LLONG_MAX);
+    parent.assign(n, -1);
+    std::vector<long long> gReverse(n, LLONG_MAX);
+    std::vector<int> next(n, -1);
+    std::vector<char> closedF(n, 0), closedR(n, 0);
+    std::vector<int> ord;
+    IndexedQuaternaryHeap openF(n), openR(n);
+    std::vector<long long> potential(n, LLONG_MIN);
+
+    auto doubledPotential = [&](int v) {
+        if (potential[v] == LLONG_MIN) potential[v] = h.estimate(v, dest) - h.estimateFrom(start, v);
+        return potential[v];
+    };
+
+    if (start == dest) {
+        gScore[start] = 0;
+        ord.push_back(start);
+        return ord;
+    }
+
+    long long best = LLONG_MAX;
+    int meet = -1;
+    gScore[start] = 0;
+    gReverse[dest] = 0;
+    openF.push(start, doubledPotential(start));
+    openR.push(dest, -doubledPotential(dest));
+
+    while (!openF.empty() && !openR.empty()) {
+        long long topF = openF.topKey(), topR = openR.topKey();
+        if (best != LLONG_MAX && topF + topR >= 2 * best) break;
+
+        bool forward = topF <= topR;
+        const CsrGraph& side = forward ? g : reverse;
+        IndexedQuaternaryHeap& open = forward ? openF : openR;
+        std::vector<long long>& dist = forward ? gScore : gReverse;
+        const std::vector<long long>& otherDist = forward ? gReverse : gScore;
+        std::vector<char>& closed = forward ? closedF : closedR;
+        std::vector<int>& link = forward ? parent : next;
+        long long sign = forward ? 1 : -1;
+
+        int u = open.pop();
+        closed[u] = 1;
+        if (!closedF[u] || !closedR[u]) ord.push_back(u);
+        GV_COUNT(NodesSettled, 1);
+        GV_COUNT(EdgesScanned, side.offsets[u + 1] - side.offsets[u]);
+
+        for (long long e = side.offsets[u]; e < side.offsets[u + 1]; ++e) {
+            int v = side.targets[e];
+            if (closed[v]) continue;
+            long long tentative = dist[u] + side.weights[e];
+            if (tentative < dist[v]) {
+                GV_COUNT(Relaxations, 1);
+                dist[v] = tentative;
+                link[v] = u;
+                long long key = 2 * tentative + sign * doubledPotential(v);
+                if (open.contains(v)) open.decreaseKey(v, key);
+                else open.push(v, key);
+                if (otherDist[v] != LLONG_MAX && tentative + otherDist[v] < best) {
+                    best = tentative + otherDist[v];
+                    meet = v;
+                }
+            }
+        }
+    }
+
+    for (int v = 0; v < n; ++v) {
+        if (!closedF[v] && v != meet) {
+            parent[v] = -1;
+            gScore[v] = LLONG_MAX;
+        }
+    }
+    if (meet != -1) {
+        for (int v = meet; v != dest; v = next[v]) {
+            parent[next[v]] = v;
+            gScore[next[v]] = best - gReverse[next[v]];
+        }
+    }
+    return ord;
+}
+
+enum class ApspMethod { Auto, FloydWarshall, Dijkstra };
+
+// Floyd–Warshall runs n^3 branch-free vector work, one Dijkstra per source about n*m*log n
+// scattered work; this factor, measured at n = 1024, calibrates one against the other.
+constexpr double kApspDijkstraCost = 3.0;
+
+ApspMethod chooseApspMethod(const CsrGraph& g) {
+    double n = g.n, m = (double)g.edgeCount();
+    return m * std::log2(n + 2.0) * kApspDijkstraCost >= n * n ? ApspMethod::FloydWarshall : ApspMethod::Dijkstra;
+}
+
+// c[i][j] = min(c[i][j], a + b[j]) over one tile row; the rows never overlap.
+template <typename T>
+void minPlusRow(T* __restrict c, const T* __restrict b, T a, int count) {
+    for (int j = 0; j < count; ++j) c[j] = std::min(c[j], (T)(a + b[j]));
+}
+
+// All-pairs shortest distances, computed once and then answered by lookup. Either a tiled
+// Floyd–Warshall or one Dijkstra per source fills a dense row-major matrix, both on the shared
+// thread pool and both over Johnson-reweighted (non-negative) weights; distance() adds the
+// potentials back. Entries are int32 when every reweighted path fits, int64 otherwise, and
+// "unreachable" is any value at or above half the type's range, so sums never overflow and
+// the inner loops need no branches.
+class DistanceMatrix {
+public:
+    // 64x64 tiles: three int32 tiles are 48 KiB and three int64 tiles 96 KiB, inside L2.
+    static constexpr int kTile = 64;
+
+    explicit DistanceMatrix(const CsrGraph& g, ApspMethod method = ApspMethod::Auto) : n(g.n) {
+        GV_TIME(Search);
+        if (!johnsonPotentials(g, potential)) {
+            negative = true;
+            return;
+        }
+        floyd = (method == ApspMethod::Auto ? chooseApspMethod(g) : method) == ApspMethod::FloydWarshall;
+        long long maxWeight = 0;
+        for (int u = 0; u < n; ++u) {
+            for (long long e = g.offsets[u]; e < g.offsets[u + 1]; ++e) {
+                maxWeight = std::max(maxWeight, g.weights[e] + potential[u] - potential[g.targets[e]]);
+            }
+        }
+        wide = (double)std::max(n - 1, 0) * maxWeight >= (double)(INT32_MAX / 2);
+        stride = floyd ? (n + kTile - 1) / kTile * kTile : n;
+        // In double, so a huge n cannot wrap the product before it is compared.
+        bytes = (double)stride * (double)stride * (wide ? sizeof(long long) : sizeof(int));
+        unsigned long long memory = physicalMemoryBytes();
+        if (bytes > (double)PTRDIFF_MAX || (memory > 0 && bytes > (double)memory)) {
+            tooBig = true;
+            return;
+        }
+        try {
+            if (wide) {
+                fill(g, wideDist);
+            } else {
+                fill(g, narrowDist);
+            }
+        } catch (const std::bad_alloc&) {
+            wideDist = {};
+            narrowDist = {};
+            tooBig = true;
+        }
+    }
+
+    int size() const { return n; }
+    bool negativeCycle() const { return negative; }
+    // The matrix did not fit in memory; nothing was computed and bytesNeeded() says how much it wanted.
+    bool tooLarge() const { return tooBig; }
+    double bytesNeeded() const { return bytes; }
+    bool usedFloydWarshall() const { return floyd; }
+    int bits() const { return wide ? 64 : 32; }
+
+    // LLONG_MAX when v is unreachable from u; meaningless after a negative cycle.
+    long long distance(int u, int v) const {
+        size_t at = (size_t)u * stride + v;
+        long long d = wide ? wideDist[at] : narrowDist[at];
+        if (d >= (wide ? LLONG_MAX / 2 : INT32_MAX / 2)) return LLONG_MAX;
+        return d - potential[u] + potential[v];
+    }
+
+private:
+    template <typename T>
+    void fill(const CsrGraph& g, std::vector<T>& dist) {
+        const T inf = std::numeric_limits<T>::max() / 2;
+        if (floyd) {
+            dist.assign((size_t)stride * stride, inf);
+            for (int v = 0; v < stride; ++v) dist[(size_t)v * stride + v] = 0;
+            for (int u = 0; u < n; ++u) {
+                for (long long e = g.offsets[u]; e < g.offsets[u + 1]; ++e) {
+                    int v = g.targets[e];
+                    T w = (T)(g.weights[e] + potential[u] - potential[v]);
+                    T& d = dist[(size_t)u * stride + v];
+                    d = std::min(d, w);
+                }
+            }
+            floydWarshall(dist.data());
+        } else {
+            dist.assign((size_t)n * n, inf);
+            manySourceDijkstra(g, dist.data());
+        }
+    }
+
+    // Blocked Floyd–Warshall: per diagonal tile, first the tile itself, then its row and column
+    // of tiles in parallel, then every other tile in parallel. Each step is a min-plus product
+    // of tiles that stay in cache; the row and column steps work in place, which is safe
+    // because a non-negative diagonal can never improve a tile's own pivot row or column.
+    template <typename T>
+    void floydWarshall(T* dist) {
+        int tiles = stride / kTile;
+        auto tile = [&](int row, int col) { return dist + (size_t)row * kTile * stride + (size_t)col * kTile; };
+        // Floyd–Warshall examines every candidate; it does not count which ones improved.
+        auto minPlus = [&](T* c, const T* a, const T* b) {
+            GV_COUNT(EdgesScanned, (long long)kTile * kTile * kTile);
+            for (int k = 0; k < kTile; ++k) {
+                const T* bk = b + (size_t)k * stride;
+                for (int i = 0; i < kTile; ++i) {
+                    T* ci = c + (size_t)i * stride;
+                    if (ci == bk) continue;
+                    minPlusRow(ci, bk, a[(size_t)i * stride + k], kTile);
+                }
+            }
+        };
+        ThreadPool& pool = sharedThreadPool();
+        for (int kb = 0; kb < tiles; ++kb) {
+            T* pivot = tile(kb, kb);
+            minPlus(pivot, pivot, pivot);
+            int others = tiles - 1;
+            pool.parallelFor(0, 2LL * others, 1, [&](long long lo, long long hi, unsigned) {
+                for (long long t = lo; t < hi; ++t) {
+                    int other = (int)(t % std::max(others, 1));
+                    other += other >= kb;
+                    if (t < others) {
+                        T* c = tile(kb, other);
+                        minPlus(c, pivot, c);
+                    } else {
+                        T* c = tile(other, kb);
+                        minPlus(c, c, pivot);
+                    }
+                }
+            });
+            pool.parallelFor(0, (long long)others * others, 1, [&](long long lo, long long hi, unsigned) {
+                for (long long t = lo; t < hi; ++t) {
+                    int row = (int)(t / others), col = (int)(t % others);
+                    row += row >= kb;
+                    col += col >= kb;
+                    minPlus(tile(row, col), tile(row, kb), tile(kb, col));
+                }
+            });
+        }
+    }
+
+    // One Dijkstra per source over the reweighted edges, sources spread over the pool. Each
+    // chunk of sources reuses one heap and distance array.
+    template <typename T>
+    void manySourceDijkstra(const CsrGraph& g, T* dist) {
+        sharedThreadPool().parallelFor(0, n, 16, [&](long long lo, long long hi, unsigned) {
+            std::vector<long long> d(n, LLONG_MAX);
+            std::vector<int> touched;
+            IndexedQuaternaryHeap heap(n);
+            for (int s = (int)lo; s < (int)hi; ++s) {
+                T* row = dist + (size_t)s * n;
+                d[s] = 0;
+                touched.push_back(s);
+                heap.push(s, 0);
+                while (!heap.empty()) {
+                    int u = heap.pop();
+                    row[u] = (T)d[u];
+                    GV_COUNT(NodesSettled, 1);
+                    GV_COUNT(EdgesScanned, g.offsets[u + 1] - g.offsets[u]);
+                    for (long long e = g.offsets[u]; e < g.offsets[u + 1]; ++e) {
+                        int v = g.targets[e];
+                        long long nd = d[u] + g.weights[e] + potential[u] - potential[v];
+                        if (nd < d[v]) {
+                            GV_COUNT(Relaxations, 1);
+                            if (d[v] == LLONG_MAX) touched.push_back(v);
+                            d[v] = nd;
+                            if (heap.contains(v)) heap.decreaseKey(v, nd);
+                            else heap.push(v, nd);
+                        }
+                    }
+                }
+                for (int v : touched) d[v] = LLONG_MAX;
+                touched.clear();
+            }
+        });
+    }
+
+    int n;
+    int stride = 0;
+    bool negative = false;
+    bool floyd = false;
+    bool wide = false;
+    bool tooBig = false;
+    double bytes = 0;
+    std::vector<long long> potential;
+    std::vector<int32_t> narrowDist;
+    std::vector<long long> wideDist;
+};
+
+const char kHierarchyMagic[8] = {'G', 'V', 'C', 'H', '0', '0', '0', '1'};
+
+// Contraction hierarchy: vertices are contracted one at a time, cheapest first by edge
+// difference (shortcuts added minus arcs removed, plus contracted neighbours to spread the
+// order evenly), and a shortcut u->x is only added when a bounded witness search finds no
+// path at least as short that avoids the contracted vertex. Queries then run two upward
+// Dijkstra searches that only ever climb in rank, which settle a few hundred vertices even on
+// large road-like graphs. Weights are Johnson-reweighted first, so negative edges work too.
+// Shortcuts remember the two arcs they bridge, which is how query paths unpack back into
+// original edges.
+class ContractionHierarchy {
+public:
+    // Witness searches give up after scanning this many arcs (a budget in arcs rather than
+    // vertices, so searches that reach a hub stay cheap); a missed witness only costs an
+    // unnecessary shortcut, never a wrong answer. Priority estimates use the smaller budget.
+    static constexpr int kWitnessArcLimit = 2000;
+    static constexpr int kEstimateArcLimit = 200;
+    // Contraction stops once the remaining vertices average this many arcs each. That core
+    // keeps all its arcs as both up and down arcs, so queries just search it bidirectionally;
+    // without the cutoff, random and scale-free graphs fill in until every contraction costs
+    // thousands of witness searches.
+    static constexpr int kCoreArcsPerVertex = 24;
+
+    struct Arc {
+        int from;
+        int to;
+        long long weight;
+        int first;   // for shortcuts, the arcs from -> middle and middle -> to; -1 otherwise
+        int second;
+    };
+
+    // Returns false on a negative cycle.
+    bool build(const CsrGraph& g) {
+        GV_TIME(Preprocess);
+        n = g.n;
+        edgeCount = g.edgeCount();
+        if (!johnsonPotentials(g, potential)) return false;
+        arcs.clear();
+        liveArcs = 0;
+        out.assign(n, {});
+        in.assign(n, {});
+        for (int u = 0; u < n; ++u) {
+            for (long long e = g.offsets[u]; e < g.offsets[u + 1]; ++e) {
+                int v = g.targets[e];
+                if (v != u) addArc(u, v, g.weights[e] + potential[u] - potential[v], -1, -1);
+            }
+        }
+
+        witnessDist.assign(n, LLONG_MAX);
+        witnessHeap = IndexedQuaternaryHeap(n);
+        witnessTarget.assign(n, 0);
+        rank.assign(n, -1);
+        std::vector<int> contractedNeighbours(n, 0);
+        std::vector<std::vector<int>> upArcs(n), downArcs(n);
+        IndexedQuaternaryHeap queue(n);
+        for (int v = 0; v < n; ++v) queue.push(v, priority(v, contractedNeighbours[v]));
+
+        int next = 0;
+        while (!queue.empty() && liveArcs <= (long long)kCoreArcsPerVertex * (n - next)) {
+            int v = queue.pop();
+            // Lazy update: priorities go stale as neighbours are contracted.
+            long long p = priority(v, contractedNeighbours[v]);
+            if (!queue.empty() && p > queue.topKey()) {
+                queue.push(v, p);
+                continue;
+            }
+            rank[v] = next++;
+            upArcs[v] = out[v];
+            downArcs[v] = in[v];
+            contract(v, false);
+            liveArcs -= in[v].size() + out[v].size();
+            for (int a : in[v]) eraseArc(out[arcs[a].from], a);
+            for (int a : out[v]) eraseArc(in[arcs[a].to], a);
+            for (int a : in[v]) ++contractedNeighbours[arcs[a].from];
+            for (int a : out[v]) ++contractedNeighbours[arcs[a].to];
+            out[v].clear();
+            in[v].clear();
+        }
+        while (!queue.empty()) {
+            int v = queue.pop();
+            rank[v] = next++;
+            upArcs[v] = out[v];
+            downArcs[v] = in[v];
+        }
+        out.clear();
+        in.clear();
+        witnessDist = {};
+        witnessTarget = {};
+        witnessHeap = IndexedQuaternaryHeap(0);
+
+        upOffsets.assign(n + 1, 0);
+        downOffsets.assign(n + 1, 0);
+        upIds.clear();
+        downIds.clear();
+        for (int v = 0; v < n; ++v) {
+            upIds.insert(upIds.end(), upArcs[v].begin(), upArcs[v].end());
+            downIds.insert(downIds.end(), downArcs[v].begin(), downArcs[v].end());
+            upOffsets[v + 1] = upIds.size();
+            downOffsets[v + 1] = downIds.size();
+        }
+        prepareQueries();
+        return true;
+    }
+
+    int shortcutCount() const {
+        return (int)std::count_if(arcs.begin(), arcs.end(), [](const Arc& a) { return a.first != -1; });
+    }
+
+    // Same native-endian layout idea as graph snapshots; the graph's n and m are stored so a
+    // hierarchy is never paired with a different graph.
+    bool save(const std::string& path) const {
+        std::ofstream file(path, std::ios::binary);
+        if (!file) {
+            std::cerr << "Error: Could not create '" << path << "'.\n";
+            return false;
+        }
+        unsigned long long header[4] = {(unsigned long long)n, (unsigned long long)edgeCount, arcs.size(), upIds.size()};
+        unsigned long long downCount = downIds.size();
+        file.write(kHierarchyMagic, sizeof(kHierarchyMagic));
+        file.write((const char*)header, sizeof(header));
+        file.write((const char*)&downCount, sizeof(downCount));
+        file.write((const char*)potential.data(), potential.size() * sizeof(long long));
+        file.write((const char*)rank.data(), rank.size() * sizeof(int));
+        file.write((const char*)arcs.data(), arcs.size() * sizeof(Arc));
+        file.write((const char*)upOffsets.data(), upOffsets.size() * sizeof(size_t));
+        file.write((const char*)upIds.data(), upIds.size() * sizeof(int));
+        file.write((const char*)downOffsets.data(), downOffsets.size() * sizeof(size_t));
+        file.write((const char*)downIds.data(), downIds.size() * sizeof(int));
+        if (!file) {
+            std::cerr << "Error: Could not write '" << path << "'.\n";
+            return false;
+        }
+        return true;
+    }
+
+    bool load(const std::string& path, const CsrGraph& g) {
+        std::ifstream file(path, std::ios::binary);
+        char magic[8];
+        unsigned long long header[4], downCount;
+        if (!file || !file.read(magic, sizeof(magic)) || std::memcmp(magic, kHierarchyMagic, sizeof(magic)) != 0 ||
+            !file.read((char*)header, sizeof(header)) || !file.read((char*)&downCount, sizeof(downCount))) {
+            std::cerr << "Error: '" << path << "' is not a contraction hierarchy.\n";
+            return false;
+        }
+        if (header[0] != (unsigned long long)g.n || header[1] != (unsigned long long)g.edgeCount()) {
+            std::cerr << "Error: '" << path << "' was built for a graph with " << header[0] << " vertices and "
+                      << header[1] << " edges.\n";
+            return false;
+        }
+        // Each count from the file is bounded by the bytes left before it is multiplied, so a
+        // hostile count cannot wrap the size check around to the real file size.
+        file.seekg(0, std::ios::end);
+        unsigned long long left = (unsigned long long)file.tellg();
+        auto take = [&](unsigned long long count, unsigned long long width) {
+            if (count > left / width) return false;
+            left -= count * width;
+            return true;
+        };
+        bool sized = take(1, sizeof(magic) + sizeof(header) + sizeof(downCount) + 2 * sizeof(size_t)) &&
+                     take(header[0], sizeof(long long) + sizeof(int) + 2 * sizeof(size_t)) &&
+                     take(header[2], sizeof(Arc)) && take(header[3], sizeof(int)) && take(downCount, sizeof(int)) &&
+                     left == 0;
+        if (!sized) {
+            std::cerr << "Error: '" << path << "' is truncated or corrupt.\n";
+            return false;
+        }
+        file.seekg(sizeof(magic) + sizeof(header) + sizeof(downCount));
+        n = g.n;
+        edgeCount = g.edgeCount();
+        potential.resize(n);
+        rank.resize(n);
+        arcs.resize(header[2]);
+        upOffsets.resize(n + 1);
+        upIds.resize(header[3]);
+        downOffsets.resize(n + 1);
+        downIds.resize(downCount);
+        file.read((char*)potential.data(), potential.size() * sizeof(long long));
+        file.read((char*)rank.data(), rank.size() * sizeof(int));
+        file.read((char*)arcs.data(), arcs.size() * sizeof(Arc));
+        file.read((char*)upOffsets.data(), upOffsets.size() * sizeof(size_t));
+        file.read((char*)upIds.data(), upIds.size() * sizeof(int));
+        file.read((char*)downOffsets.data(), downOffsets.size() * sizeof(size_t));
+        file.read((char*)downIds.data(), downIds.size() * sizeof(int));
+        bool sane = (bool)file && upOffsets[0] == 0 && downOffsets[0] == 0 && upOffsets[n] == upIds.size() &&
+                    downOffsets[n] == downIds.size();
+        for (int v = 0; sane && v < n; ++v) {
+            sane = upOffsets[v] <= upOffsets[v + 1] && downOffsets[v] <= downOffsets[v + 1];
+        }
+        // A shortcut always comes after the arcs it bridges, which also keeps unpacking finite.
+        for (size_t i = 0; i < arcs.size(); ++i) {
+            const Arc& arc = arcs[i];
+            sane = sane && arc.from >= 0 && arc.from < n && arc.to >= 0 && arc.to < n &&
+                   arc.first >= -1 && arc.first < (long long)i && arc.second >= -1 && arc.second < (long long)i;
+        }
+        for (int a : upIds) sane = sane && a >= 0 && a < (long long)arcs.size();
+        for (int a : downIds) sane = sane && a >= 0 && a < (long long)arcs.size();
+        if (!sane) {
+            std::cerr << "Error: '" << path << "' is truncated or corrupt.\n";
+            return false;
+        }
+        prepareQueries();
+        return true;
+    }
+
+    // Returns the s-t distance (LLONG_MAX if unreachable) and fills path with the original
+    // vertices from s to t and pathDist with their distances from s. Vertices settled by either
+    // search are appended to settled. The search state is reused between queries, so one
+    // hierarchy serves one query at a time.
+    long long query(int s, int t, std::vector<int>& path, std::vector<long long>& pathDist,
+                    std::vector<int>* settled = nullptr) {
+        path.clear();
+        pathDist.clear();
+        for (int side = 0; side < 2; ++side) {
+            Search& search = searches[side];
+            for (int v : search.touched) {
+                search.dist[v] = LLONG_MAX;
+                search.parentArc[v] = -1;
+            }
+            search.touched.clear();
+            int start = side == 0 ? s : t;
+            search.dist[start] = 0;
+            search.touched.push_back(start);
+            search.heap.push(start, 0);
+        }
+
+        long long best = LLONG_MAX;
+        int meet = -1;
+        while (true) {
+            // Advance whichever side has the smaller key; stop once neither can beat best.
+            int side = -1;
+            for (int k = 0; k < 2; ++k) {
+                const Search& search = searches[k];
+                if (search.heap.empty() || search.heap.topKey() >= best) continue;
+                if (side == -1 || search.heap.topKey() < searches[side].heap.topKey()) side = k;
+            }
+            if (side == -1) break;
+            Search& search = searches[side];
+            const Search& other = searches[1 - side];
+            int u = search.heap.pop();
+            if (settled) settled->push_back(u);
+            GV_COUNT(NodesSettled, 1);
+            if (other.dist[u] != LLONG_MAX && search.dist[u] + other.dist[u] < best) {
+                best = search.dist[u] + other.dist[u];
+                meet = u;
+            }
+            const std::vector<size_t>& offsets = side == 0 ? upOffsets : downOffsets;
+            const std::vector<int>& ids = side == 0 ? upIds : downIds;
+            GV_COUNT(EdgesScanned, offsets[u + 1] - offsets[u]);
+            for (size_t i = offsets[u]; i < offsets[u + 1]; ++i) {
+                const Arc& arc = arcs[ids[i]];
+                int v = side == 0 ? arc.to : arc.from;
+                long long nd = search.dist[u] + arc.weight;
+                if (nd < search.dist[v]) {
+                    GV_COUNT(Relaxations, 1);
+                    if (search.dist[v] == LLONG_MAX) search.touched.push_back(v);
+                    search.dist[v] = nd;
+                    search.parentArc[v] = ids[i];
+                    if (search.heap.contains(v)) search.heap.decreaseKey(v, nd);
+                    else search.heap.push(v, nd);
+                }
+            }
+        }
+        for (Search& search : searches) search.heap.clear();
+        if (meet == -1) return LLONG_MAX;
+
+        // Arcs of the up-down path in order, then each one unpacked into original edges.
+        std::vector<int> pathArcs;
+        for (int v = meet; searches[0].parentArc[v] != -1; v = arcs[searches[0].parentArc[v]].from) {
+            pathArcs.push_back(searches[0].parentArc[v]);
+        }
+        std::reverse(pathArcs.begin(), pathArcs.end());
+        for (int v = meet; searches[1].parentArc[v] != -1; v = arcs[searches[1].parentArc[v]].to) {
+            pathArcs.push_back(searches[1].parentArc[v]);
+        }
+        path.push_back(s);
+        pathDist.push_back(0);
+        std::vector<int> stack;
+        for (int a : pathArcs) {
+            stack.push_back(a);
+            while (!stack.empty()) {
+                const Arc& arc = arcs[stack.back()];
+                stack.pop_back();
+                if (arc.first == -1) {
+                    path.push_back(arc.to);
+                    pathDist.push_back(pathDist.back() + arc.weight - potential[arc.from] + potential[arc.to]);
+                } else {
+                    stack.push_back(arc.second);
+                    stack.push_back(arc.first);
+                }
+            }
+        }
+        return best - potential[s] + potential[t];
+    }
+
+private:
+    struct Search {
+        std::vector<long long> dist;
+        std::vector<int> parentArc;
+        std::vector<int> touched;
+        IndexedQuaternaryHeap heap{0};
+    };
+
+    void addArc(int from, int to, long long weight, int first, int second) {
+        // Parallel arcs collapse to the lightest one.
+        for (int& a : out[from]) {
+            if (arcs[a].to != to) continue;
+            if (arcs[a].weight <= weight) return;
+            int old = a;
+            a = (int)arcs.size();
+            std::replace(in[to].begin(), in[to].end(), old, a);
+            arcs.push_back(Arc{from, to, weight, first, second});
+            return;
+        }
+        out[from].push_back((int)arcs.size());
+        in[to].push_back((int)arcs.size());
+        arcs.push_back(Arc{from, to, weight, first, second});
+        ++liveArcs;
+    }
+
+    static void eraseArc(std::vector<int>& list, int a) {
+        list.erase(std::find(list.begin(), list.end(), a));
+    }
+
+    long long priority(int v, int contractedNeighbours) {
+        int shortcuts = contract(v, true);
+        return (long long)shortcuts - (long long)(in[v].size() + out[v].size()) + contractedNeighbours;
+    }
+
+    // Finds (and unless simulating, adds) the shortcuts that contracting v needs; returns how many.
+    int contract(int v, bool simulate) {
+        int count = 0;
+        long long maxOut = 0;
+        for (int b : out[v]) maxOut = std::max(maxOut, arcs[b].weight);
+        // Copies, since adding shortcuts can reallocate the lists being walked.
+        std::vector<int> incoming = in[v], outgoing = out[v];
+        for (int b : outgoing) witnessTarget[arcs[b].to] = 1;
+        for (int a : incoming) {
+            int u = arcs[a].from;
+            long long toV = arcs[a].weight;
+            int targets = (int)outgoing.size() - witnessTarget[u];
+            witnessSearch(u, v, toV + maxOut, targets, simulate ? kEstimateArcLimit : kWitnessArcLimit);
+            for (int b : outgoing) {
+                int x = arcs[b].to;
+                if (x == u) continue;
+                long long via = toV + arcs[b].weight;
+                if (witnessDist[x] <= via) continue;
+                ++count;
+                if (!simulate) addArc(u, x, via, a, b);
+            }
+            for (int w : witnessTouched) witnessDist[w] = LLONG_MAX;
+            witnessTouched.clear();
+        }
+        for (int b : outgoing) witnessTarget[arcs[b].to] = 0;
+        return count;
+    }
+
+    // Dijkstra from u that avoids v; stops past `limit`, once all `targets` of v's out-neighbours
+    // are settled, or after scanning arcLimit arcs.
+    void witnessSearch(int u, int v, long long limit, int targets, int arcLimit) {
+        witnessDist[u] = 0;
+        witnessTouched.push_back(u);
+        witnessHeap.push(u, 0);
+        int scanned = 0;
+        while (!witnessHeap.empty() && targets > 0 && scanned < arcLimit) {
+            long long d = witnessHeap.topKey();
+            int w = witnessHeap.pop();
+            if (d > limit) break;
+            if (w != u && witnessTarget[w]) --targets;
+            scanned += (int)out[w].size();
+            for (int a : out[w]) {
+                int x = arcs[a].to;
+                long long nd = d + arcs[a].weight;
+                if (x == v || nd > limit) continue;
+                if (nd < witnessDist[x]) {
+                    if (witnessDist[x] == LLONG_MAX) witnessTouched.push_back(x);
+                    witnessDist[x] = nd;
+                    if (witnessHeap.contains(x)) witnessHeap.decreaseKey(x, nd);
+                    else witnessHeap.push(x, nd);
+                }
+            }
+        }
+        witnessHeap.clear();
+    }
+
+    void prepareQueries() {
+        for (Search& search : searches) {
+            search.dist.assign(n, LLONG_MAX);
+            search.parentArc.assign(n, -1);
+            search.touched.clear();
+            search.heap = IndexedQuaternaryHeap(n);
+        }
+    }
+
+    int n = 0;
+    long long edgeCount = 0;
+    std::vector<long long> potential;
+    std::vector<int> rank;
+    std::vector<Arc> arcs;
+    // Upward arcs leaving each vertex, and arcs entering each vertex from a higher one.
+    std::vector<size_t> upOffsets, downOffsets;
+    std::vector<int> upIds, downIds;
+
+    // Preprocessing only.
+    std::vector<std::vector<int>> out, in;
+    long long liveArcs = 0;
+    std::vector<long long> witnessDist;
+    std::vector<char> witnessTarget;
+    std::vector<int> witnessTouched;
+    IndexedQuaternaryHeap witnessHeap{0};
+
+    Search searches[2];
+};
+
+enum class GraphAlgorithm {
+    Dijkstra, Bfs, BellmanFord, Prim, AStar, DeltaStepping, BfsDirectionOptimizing, Kruskal, Boruvka,
+    BidirectionalAStarAlt, DijkstraBinary, DijkstraRadix, BellmanFordRounds, BellmanFordParallel, AStarAlt,
+    ContractionHierarchy
+};
+
+struct GraphAlgorithmInfo {
+    GraphAlgorithm id;
+    const char* name;
+    const char* menuLabel;
+    const char* title;
+    bool shortestPath;
+    bool needsDestination;
+};
+
+const GraphAlgorithmInfo kGraphAlgorithms[] = {
+    {GraphAlgorithm::Dijkstra, "dijkstra", "Dijkstra", "Dijkstra Visualization", true, false},
+    {GraphAlgorithm::Bfs, "bfs", "BFS", "BFS Visualization", true, false},
+    {GraphAlgorithm::BellmanFord, "bellman-ford", "Bellman-Ford", "Bellman-Ford Visualization", true, false},
+    {GraphAlgorithm::Prim, "prim", "MST (Prim's)", "Prim's MST Visualization", false, false},
+    {GraphAlgorithm::AStar, "astar", "A* Search", "A* Search Visualization", true, true},
+    {GraphAlgorithm::DeltaStepping, "delta-stepping", "Dijkstra (parallel delta-stepping)",
+     "Dijkstra (Delta-Stepping) Visualization", true, false},
+    {GraphAlgorithm::BfsDirectionOptimizing, "bfs-do", "BFS (direction-optimizing)",
+     "BFS (Direction-Optimizing) Visualization", true, false},
+    {GraphAlgorithm::Kruskal, "kruskal", "MST (Kruskal's)", "Kruskal's MST Visualization", false, false},
+    {GraphAlgorithm::Boruvka, "boruvka", "MST (Boruvka's, parallel)", "Boruvka's MST Visualization", false, false},
+    {GraphAlgorithm::BidirectionalAStarAlt, "astar-bidir", "A* (bidirectional, ALT landmarks)",
+     "Bidirectional A* (ALT) Visualization", true, true},
+    {GraphAlgorithm::DijkstraBinary, "dijkstra-binary", "Dijkstra (binary heap)", "Dijkstra Visualization", true, false},
+    {GraphAlgorithm::DijkstraRadix, "dijkstra-radix", "Dijkstra (radix heap)", "Dijkstra Visualization", true, false},
+    {GraphAlgorithm::BellmanFordRounds, "bellman-ford-rounds", "Bellman-Ford (rounds)",
+     "Bellman-Ford Visualization", true, false},
+    {GraphAlgorithm::BellmanFordParallel, "bellman-ford-parallel", "Bellman-Ford (parallel)",
+     "Bellman-Ford Visualization", true, false},
+    {GraphAlgorithm::AStarAlt, "astar-alt", "A* (ALT landmarks)", "A* Search (ALT) Visualization", true, true},
+    {GraphAlgorithm::ContractionHierarchy, "ch", "Contraction hierarchy query", "Contraction Hierarchy Visualization",
+     true, true},
+};
+
+const GraphAlgorithmInfo* findGraphAlgorithm(const std::string& name) {
+    for (const auto& info : kGraphAlgorithms) {
+        if (name == info.name) return &info;
+    }
+    return nullptr;
+}
+
+bool isBfs(const GraphAlgorithmInfo& algo) {
+    return algo.id == GraphAlgorithm::Bfs || algo.id == GraphAlgorithm::BfsDirectionOptimizing;
+}
+
+// Weighted shortest-path searches, the ones whose per-node distances are worth drawing.
+bool showsDistances(const GraphAlgorithmInfo& algo) {
+    return algo.shortestPath && !isBfs(algo);
+}
+
+// Per-graph data that several queries can share: the reverse graph, ALT landmarks and the
+// contraction hierarchy are built on first use.
+struct GraphContext {
+    const CsrGraph& graph;
+    const std::vector<sf::Vector2f>& pos;
+    std::optional<CsrGraph> reverse{};
+    std::optional<Landmarks> landmarks{};
+    std::optional<ContractionHierarchy> hierarchy{};
+    bool hierarchyFailed = false;
+    long long delta = 0; // delta-stepping bucket width; 0 derives it from the graph
+
+    const CsrGraph& reverseGraph() {
+        if (!reverse) {
+            GV_TIME(Preprocess);
+            reverse = transposeCsr(graph);
+        }
+        return *reverse;
+    }
+
+    const Landmarks& landmarkSet() {
+        if (!landmarks) landmarks = selectLandmarks(graph, 8);
+        return *landmarks;
+    }
+
+    // Null when the graph has a negative cycle.
+    ContractionHierarchy* contractionHierarchy() {
+        if (!hierarchy && !hierarchyFailed) {
+            hierarchy.emplace();
+            if (!hierarchy->build(graph)) {
+                hierarchy.reset();
+                hierarchyFailed = true;
+            }
+        }
+        return hierarchy ? &*hierarchy : nullptr;
+    }
+};
+
+struct GraphRun {
+    std::vector<int> order;
+    std::vector<int> parent;
+    std::vector<long long> dist;
+    long long totalCost = 0;
+    bool negativeCycle = false;
+};
+
+// With a trace ring, the sequential algorithms record their own events as they go; the parallel
+// ones and those whose visit order is only known at the end get a synthesized trace of one
+// relax and one visit per vertex, in visit order.
+GraphRun runGraphAlgorithm(const GraphAlgorithmInfo& algo, GraphContext& ctx, int source, int dest,
+                           EventRing* trace = nullptr) {
+    // Includes any preprocessing the context builds on first use, which is also timed on its own.
+    GV_TIME(Search);
+    const CsrGraph& graph = ctx.graph;
+    GraphRun run;
+    run.parent.assign(graph.n, -1);
+    run.dist.assign(graph.n, LLONG_MAX);
+    bool traced = true;
+
+    switch (algo.id) {
+    case GraphAlgorithm::Dijkstra:
+        run.order = dijkstraOrder(graph, run.parent, run.dist, source, HeapKind::Quaternary, trace);
+        break;
+    case GraphAlgorithm::DijkstraBinary:
+        run.order = dijkstraOrder(graph, run.parent, run.dist, source, HeapKind::Binary, trace);
+        break;
+    case GraphAlgorithm::DijkstraRadix:
+        run.order = dijkstraOrder(graph, run.parent, run.dist, source, HeapKind::Radix, trace);
+        break;
+    case GraphAlgorithm::DeltaStepping:
+        run.order = deltaSteppingOrder(graph, run.parent, run.dist, source, ctx.delta);
+        traced = false;
+        break;
+    case GraphAlgorithm::Bfs:
+        run.order = bfsOrder(graph, run.parent, source, trace);
+        break;
+    case GraphAlgorithm::BfsDirectionOptimizing:
+        run.order = bfsDirectionOptimizing(graph, run.parent, source);
+        traced = false;
+        break;
+    case GraphAlgorithm::BellmanFord:
+    case GraphAlgorithm::BellmanFordRounds:
+    case GraphAlgorithm::BellmanFordParallel: {
+        BellmanFordMode mode = BellmanFordMode::Queue;
+        if (algo.id == GraphAlgorithm::BellmanFordRounds) mode = BellmanFordMode::Rounds;
+        if (algo.id == GraphAlgorithm::BellmanFordParallel) mode = BellmanFordMode::Parallel;
+        run.negativeCycle = bellmanFord(graph, run.parent, run.dist, source, mode, trace);
+        for (int i = 0; i < graph.n; ++i) {
+            if (run.dist[i] != LLONG_MAX) {
+                run.order.push_back(i);
+            }
+        }
+        // Bellman-Ford only knows which vertices are final once it stops relaxing.
+        if (mode == BellmanFordMode::Parallel) {
+            traced = false;
+        } else {
+            for (int v : run.order) traceEvent(trace, TraceKind::Visit, v, run.parent[v], run.dist[v]);
+        }
+        break;
+    }
+    case GraphAlgorithm::Prim:
+        run.order = mstPrimsOrder(graph, run.parent, run.totalCost, source, trace);
+        break;
+    case GraphAlgorithm::Kruskal:
+        run.order = mstKruskalOrder(graph, run.parent, run.totalCost);
+        traced = false;
+        break;
+    case GraphAlgorithm::Boruvka:
+        run.order = mstBoruvkaOrder(graph, run.parent, run.totalCost);
+        traced = false;
+        break;
+    case GraphAlgorithm::AStar:
+        run.order = aStarOrder(graph, run.parent, run.dist, euclideanHeuristic(graph, ctx.pos), source, dest, trace);
+        break;
+    case GraphAlgorithm::AStarAlt:
+        run.order = aStarOrder(graph, run.parent, run.dist, landmarkHeuristic(ctx.landmarkSet()), source, dest, trace);
+        break;
+    case GraphAlgorithm::BidirectionalAStarAlt:
+        run.order = bidirectionalAStarOrder(graph, ctx.reverseGraph(), run.parent, run.dist,
+                                            landmarkHeuristic(ctx.landmarkSet()), source, dest);
+        traced = false;
+        break;
+    case GraphAlgorithm::ContractionHierarchy: {
+        traced = false;
+        ContractionHierarchy* ch = ctx.contractionHierarchy();
+        if (!ch) {
+            run.negativeCycle = true;
+            break;
+        }
+        std::vector<int> settled, path;
+        std::vector<long long> pathDist;
+        ch->query(source, dest, path, pathDist, &settled);
+        // Both searches can settle the same vertex; the order lists it once.
+        std::vector<char> seen(graph.n, 0);
+        for (int v : settled) {
+            if (!seen[v]) run.order.push_back(v);
+            seen[v] = 1;
+        }
+        for (size_t i = 0; i < path.size(); ++i) {
+            run.dist[path[i]] = pathDist[i];
+            if (i > 0) run.parent[path[i]] = path[i - 1];
+        }
+        break;
+    }
+    }
+
+    if (trace && !traced) {
+        // Vertices that got a parent without being visited still end up with their tree edge.
+        std::vector<char> inOrder(graph.n, 0);
+        auto relax = [&](int v) {
+            long long value = run.dist[v] != LLONG_MAX ? run.dist[v] : 0;
+            if (run.parent[v] != -1) traceEvent(trace, TraceKind::Relax, v, run.parent[v], value);
+            return value;
+        };
+        for (int v : run.order) {
+            inOrder[v] = 1;
+            traceEvent(trace, TraceKind::Visit, v, run.parent[v], relax(v));
+        }
+        for (int v = 0; v < graph.n; ++v) {
+            if (!inOrder[v]) relax(v);
+        }
+    }
+    return run;
+}
+
+std::vector<sf::Vector2f> circleLayout(int n) {
+    std::vector<sf::Vector2f> pos(n);
+    // The radius grows with n so neighbours stay about 60 units apart along the circle.
+    float cx = 400.f, cy = 300.f, R = std::max(200.f, 60.f * n / (2.f * 3.14159265f));
+    for (int i = 0; i < n; ++i) {
+        float ang = i * 2.f * 3.14159265f / std::max(1, n);
+        pos[i] = sf::Vector2f(cx + R * std::cos(ang), cy + R * std::sin(ang));
+    }
+    return pos;
+}
+
+// Force-directed layout on a background thread: spring attraction along edges, Barnes–Hut
+// quadtree repulsion and a pull towards the centre, with the step size capped by a cooling
+// temperature. A random start folds large graphs up, so the graph is first coarsened by
+// matching neighbours; the coarsest level is laid out from scratch and each finer level starts
+// from its parent's position and only refines. Iterations fan out over the shared thread pool
+// and every one publishes full-resolution positions, which the render loop picks up via poll().
+class ForceLayout {
+public:
+    static constexpr float kEdgeLength = 60.f;
+    static constexpr float kTheta = 0.9f;
+    static constexpr float kGravity = 3.f;
+    static constexpr int kCoarsestIterations = 300;
+    static constexpr int kRefineIterations = 60;
+
+    explicit ForceLayout(const CsrGraph& g, ThreadPool& pool = sharedThreadPool()) : pool(pool) {
+        n = g.n;
+        buildLevels(g);
+        std::mt19937 rng(12345);
+        std::uniform_real_distribution<float> jitter(-0.5f, 0.5f);
+        offset.resize(n);
+        for (auto& o : offset) o = sf::Vector2f(jitter(rng), jitter(rng)) * (kEdgeLength / 4.f);
+        const Level& top = levels.back();
+        float side = kEdgeLength * std::sqrt((float)std::max(1, top.size));
+        pos.resize(top.size);
+        for (auto& p : pos) p = kCentre + sf::Vector2f(jitter(rng), jitter(rng)) * side;
+        ancestor.resize(n);
+        for (int v = 0; v < n; ++v) ancestor[v] = v;
+        for (size_t l = 0; l + 1 < levels.size(); ++l) {
+            for (int& a : ancestor) a = levels[l].coarse[a];
+        }
+        published.resize(n);
+        publish();
+    }
+
+    ~ForceLayout() { stop(); }
+
+    void start() {
+        worker = std::thread([this] {
+            for (int l = (int)levels.size() - 1; l >= 0 && !stopping; --l) {
+                if (l + 1 < (int)levels.size()) prolong(l);
+                const Level& level = levels[l];
+                bool coarsest = l + 1 == (int)levels.size();
+                int iterations = coarsest ? kCoarsestIterations : kRefineIterations;
+                temperature = coarsest ? kEdgeLength * std::sqrt((float)std::max(1, level.size)) / 10.f : kEdgeLength;
+                float cooling = std::pow(0.5f / temperature, 1.f / iterations);
+                for (int it = 0; it < iterations && !stopping; ++it) {
+                    bool settled = step(level);
+                    temperature *= cooling;
+                    publish();
+                    if (settled) break;
+                }
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            done = true;
+            finished.notify_all();
+        });
+    }
+
+    void stop() {
+        stopping = true;
+        if (worker.joinable()) worker.join();
+    }
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [&] { return done.load(); });
+    }
+
+    bool converged() const { return done; }
+
+    int iterations() const { return iteration; }
+
+    // Copies the newest published positions into out when they are newer than `seen`.
+    bool poll(std::vector<sf::Vector2f>& out, uint64_t& seen) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (version == seen) return false;
+        out = published;
+        seen = version;
+        return true;
+    }
+
+private:
+    static constexpr sf::Vector2f kCentre{400.f, 300.f};
+
+    // Undirected adjacency of one level; `coarse` maps each vertex to its group one level up.
+    struct Level {
+        int size = 0;
+        std::vector<long long> offsets;
+        std::vector<int> targets;
+        std::vector<int> coarse;
+    };
+
+    struct Cell {
+        sf::Vector2f center{};
+        float half = 0.f;
+        sf::Vector2f mass{};  // sum of member positions, divided out once the tree is built
+        int count = 0;
+        int child = -1;     // first of four consecutive children, -1 for a leaf
+    };
+
+    static Level undirectedLevel(int size, std::vector<std::pair<int, int>>& edges) {
+        std::sort(edges.begin(), edges.end());
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+        Level level;
+        level.size = size;
+        level.offsets.assign(size + 1, 0);
+        for (auto [u, v] : edges) level.offsets[u + 1]++;
+        for (int v = 0; v < size; ++v) level.offsets[v + 1] += level.offsets[v];
+        level.targets.reserve(edges.size());
+        for (auto [u, v] : edges) level.targets.push_back(v);
+        return level;
+    }
+
+    void buildLevels(const CsrGraph& g) {
+        std::vector<std::pair<int, int>> edges;
+        edges.reserve(g.targets.size() * 2);
+        for (int u = 0; u < g.n; ++u) {
+            for (long long e = g.offsets[u]; e < g.offsets[u + 1]; ++e) {
+                int v = g.targets[e];
+                if (u == v) continue;
+                edges.push_back({u, v});
+                edges.push_back({v, u});
+            }
+        }
+        levels.push_back(undirectedLevel(g.n, edges));
+
+        // Match each vertex with an unmatched neighbour; leftovers join a matched neighbour's
+        // group, so only isolated vertices survive a round uncoarsened.
+        std::mt19937 rng(7);
+        while (levels.back().size > 64) {
+            Level& fine = levels.back();
+            std::vector<int> visit(fine.size);
+            for (int v = 0; v < fine.size; ++v) visit[v] = v;
+            std::shuffle(visit.begin(), visit.end(), rng);
+            fine.coarse.assign(fine.size, -1);
+            int groups = 0;
+            for (int u : visit) {
+                if (fine.coarse[u] >= 0) continue;
+                for (long long e = fine.offsets[u]; e < fine.offsets[u + 1]; ++e) {
+                    int v = fine.targets[e];
+                    if (fine.coarse[v] < 0) {
+                        fine.coarse[u] = fine.coarse[v] = groups++;
+                        break;
+                    }
+                }
+            }
+            for (int u : visit) {
+                if (fine.coarse[u] >= 0) continue;
+                if (fine.offsets[u] < fine.offsets[u + 1]) fine.coarse[u] = fine.coarse[fine.targets[fine.offsets[u]]];
+                if (fine.coarse[u] < 0) fine.coarse[u] = groups++;
+            }
+            if (groups > fine.size * 0.9) {
+                fine.coarse.clear();
+                break;
+            }
+            edges.clear();
+            for (int u = 0; u < fine.size; ++u) {
+                for (long long e = fine.offsets[u]; e < fine.offsets[u + 1]; ++e) {
+                    int a = fine.coarse[u], b = fine.coarse[fine.targets[e]];
+                    if (a != b) edges.push_back({a, b});
+                }
+            }
+            Level next = undirectedLevel(groups, edges);
+            levels.push_back(std::move(next));
+        }
+    }
+
+    // Children start on their group's position, spread out to the finer level's density.
+    void prolong(int l) {
+        const Level& fine = levels[l];
+        float spread = std::sqrt((float)fine.size / std::max(1, levels[l + 1].size));
+        std::vector<sf::Vector2f> finer(fine.size);
+        for (int v = 0; v < fine.size; ++v) {
+            finer[v] = kCentre + (pos[fine.coarse[v]] - kCentre) * spread + offset[v];
+        }
+        pos.swap(finer);
+        for (int v = 0; v < n; ++v) {
+            int a = v;
+            for (int k = 0; k < l; ++k) a = levels[k].coarse[a];
+            ancestor[v] = a;
+        }
+    }
+
+    void publish() {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int v = 0; v < n; ++v) published[v] = pos[ancestor[v]] + (ancestor[v] == v ? sf::Vector2f() : offset[v]);
+        version++;
+    }
+
+    static int quadrant(const Cell& c, sf::Vector2f p) {
+        return (p.x >= c.center.x ? 1 : 0) | (p.y >= c.center.y ? 2 : 0);
+    }
+
+    void buildTree() {
+        sf::Vector2f lo = pos[0], hi = pos[0];
+        for (sf::Vector2f p : pos) {
+            lo.x = std::min(lo.x, p.x); lo.y = std::min(lo.y, p.y);
+            hi.x = std::max(hi.x, p.x); hi.y = std::max(hi.y, p.y);
+        }
+        cells.clear();
+        cells.push_back(Cell{(lo + hi) / 2.f, std::max(hi.x - lo.x, hi.y - lo.y) / 2.f + 1.f});
+        leafBody.assign(1, -1);
+        // Coincident points stop splitting at this depth and share one leaf.
+        const int kMaxDepth = 24;
+        for (int i = 0; i < (int)pos.size(); ++i) {
+            sf::Vector2f p = pos[i];
+            int node = 0;
+            for (int depth = 0;; ++depth) {
+                if (cells[node].count == 0) {
+                    cells[node].mass = p;
+                    cells[node].count = 1;
+                    leafBody[node] = i;
+                    break;
+                }
+                if (cells[node].child < 0) {
+                    if (depth >= kMaxDepth) {
+                        cells[node].mass += p;
+                        cells[node].count++;
+                        leafBody[node] = -1;
+                        break;
+                    }
+                    // Split: push the resident body down into its quadrant.
+                    int first = (int)cells.size();
+                    float h = cells[node].half / 2.f;
+                    for (int q = 0; q < 4; ++q) {
+                        sf::Vector2f c = cells[node].center + sf::Vector2f(q & 1 ? h : -h, q & 2 ? h : -h);
+                        cells.push_back(Cell{c, h});
+                        leafBody.push_back(-1);
+                    }
+                    cells[node].child = first;
+                    int resident = leafBody[node];
+                    leafBody[node] = -1;
+                    int slot = first + quadrant(cells[node], pos[resident]);
+                    cells[slot].mass = pos[resident];
+                    cells[slot].count = 1;
+                    leafBody[slot] = resident;
+                }
+                cells[node].mass += p;
+                cells[node].count++;
+                node = cells[node].child + quadrant(cells[node], p);
+            }
+        }
+        for (Cell& c : cells) {
+            if (c.count) c.mass = c.mass / (float)c.count;
+        }
+    }
+
+    sf::Vector2f repulsion(int i, std::vector<int>& stack) const {
+        const float k2 = kEdgeLength * kEdgeLength;
+        sf::Vector2f p = pos[i];
+        sf::Vector2f force(0.f, 0.f);
+        stack.assign(1, 0);
+        while (!stack.empty()) {
+            int node = stack.back();
+            stack.pop_back();
+            const Cell& c = cells[node];
+            if (c.count == 0 || leafBody[node] == i) continue;
+            sf::Vector2f d = p - c.mass;
+            float dist2 = d.x * d.x + d.y * d.y;
+            bool inside = std::abs(p.x - c.center.x) <= c.half && std::abs(p.y - c.center.y) <= c.half;
+            if (c.child < 0 || (!inside && 4.f * c.half * c.half < kTheta * kTheta * dist2)) {
+                if (dist2 < 1e-4f) continue;
+                force += d * (k2 * c.count / dist2);
+            } else {
+                for (int q = 0; q < 4; ++q) stack.push_back(c.child + q);
+            }
+        }
+        return force;
+    }
+
+    // One iteration over a level; returns true once no vertex moved more than half a unit.
+    bool step(const Level& level) {
+        if (level.size == 0) return true;
+        buildTree();
+        next.resize(level.size);
+        std::vector<std::vector<int>> stacks(pool.size());
+        std::vector<float> moved(pool.size(), 0.f);
+        pool.parallelFor(0, level.size, 256, [&](long long lo, long long hi, unsigned worker) {
+            for (int i = (int)lo; i < (int)hi; ++i) {
+                sf::Vector2f f = repulsion(i, stacks[worker]);
+                for (long long e = level.offsets[i]; e < level.offsets[i + 1]; ++e) {
+                    sf::Vector2f d = pos[level.targets[e]] - pos[i];
+                    f += d * (std::sqrt(d.x * d.x + d.y * d.y) / kEdgeLength);
+                }
+                f += (kCentre - pos[i]) * kGravity;
+                float len = std::sqrt(f.x * f.x + f.y * f.y);
+                float move = std::min(len, temperature);
+                next[i] = len > 0.f ? pos[i] + f * (move / len) : pos[i];
+                moved[worker] = std::max(moved[worker], move);
+            }
+        });
+        pos.swap(next);
+        iteration++;
+        return *std::max_element(moved.begin(), moved.end()) < 0.5f;
+    }
+
+    ThreadPool& pool;
+    int n = 0;
+    std::vector<Level> levels;
+    std::vector<int> ancestor;          // each vertex's group on the level being laid out
+    std::vector<sf::Vector2f> offset;   // fixed jitter that separates siblings after prolonging
+    std::vector<sf::Vector2f> pos;
+    std::vector<sf::Vector2f> next;
+    std::vector<Cell> cells;
+    std::vector<int> leafBody;
+    float temperature = 0.f;
+    int iteration = 0;
+
+    std::thread worker;
+    std::atomic<bool> stopping{false};
+    std::mutex mutex;
+    std::condition_variable finished;
+    std::vector<sf::Vector2f> published;
+    uint64_t version = 0;
+    std::atomic<bool> done{false};
+};
+
+#if defined(_WIN32)
+const char* const kDefaultFontPath = "C:/Windows/Fonts/arial.ttf";
+#else
+const char* const kDefaultFontPath = "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf";
+#endif
+
+// Font for every view and export; --font replaces the platform default.
+std::string& fontPath() {
+    static std::string path = kDefaultFontPath;
+    return path;
+}
+
+bool loadFont(sf::Font& font) {
+    if (!font.openFromFile(fontPath())) {
+        std::cerr << "Error: Could not load font '" << fontPath() << "' (pass --font PATH).\n";
+        return false;
+    }
+    return true;
+}
+
+// A batch of triangles kept on the CPU and, where vertex buffers are supported, mirrored on
+// the GPU. Colour changes mark a dirty range so only that slice is re-uploaded before a draw.
+struct VertexBatch {
+    std::vector<sf::Vertex> vertices;
+    sf::VertexBuffer buffer{sf::PrimitiveType::Triangles, sf::VertexBuffer::Usage::Dynamic};
+    bool onGpu = false;
+    size_t dirtyBegin = 0;
+    size_t dirtyEnd = 0;
+
+    void upload() {
+        onGpu = sf::VertexBuffer::isAvailable() && !vertices.empty() &&
+                buffer.create(vertices.size()) && buffer.update(vertices.data());
+        dirtyBegin = dirtyEnd = 0;
+    }
+
+    void setColor(size_t first, size_t count, sf::Color color) {
+        for (size_t i = first; i < first + count; ++i) vertices[i].color = color;
+        touch(first, count);
+    }
+
+    // Marks vertices edited in place so the next draw re-uploads them.
+    void touch(size_t first, size_t count) {
+        if (dirtyBegin == dirtyEnd) {
+            dirtyBegin = first;
+            dirtyEnd = first + count;
+        } else {
+            dirtyBegin = std::min(dirtyBegin, first);
+            dirtyEnd = std::max(dirtyEnd, first + count);
+        }
+    }
+
+    void draw(sf::RenderTarget& target, size_t first, size_t count, const sf::RenderStates& states) {
+        count = std::min(count, vertices.size() - std::min(first, vertices.size()));
+        if (count == 0) return;
+        if (!onGpu) {
+            target.draw(vertices.data() + first, count, sf::PrimitiveType::Triangles, states);
+            return;
+        }
+        if (dirtyBegin < dirtyEnd) {
+            buffer.update(vertices.data() + dirtyBegin, dirtyEnd - dirtyBegin, (unsigned)dirtyBegin);
+            dirtyBegin = dirtyEnd = 0;
+        }
+        target.draw(buffer, first, count, states);
+    }
+};
+
+// White anti-aliased disc; node quads are tinted through their vertex colours.
+bool makeDiscTexture(sf::Texture& texture) {
+    const unsigned size = 64;
+    sf::Image image(sf::Vector2u{size, size}, sf::Color::Transparent);
+    float c = size / 2.f;
+    for (unsigned y = 0; y < size; ++y) {
+        for (unsigned x = 0; x < size; ++x) {
+            float d = std::hypot(x + 0.5f - c, y + 0.5f - c);
+            float a = std::clamp(c - 1.f - d + 0.5f, 0.f, 1.f);
+            image.setPixel({x, y}, sf::Color(255, 255, 255, (uint8_t)std::lround(a * 255.f)));
+        }
+    }
+    if (!texture.loadFromImage(image)) return false;
+    texture.setSmooth(true);
+    return true;
+}
+
+// Uniform grid over node positions. Nodes are bucketed by cell in row-major order, so a
+// rectangle of cells maps to one contiguous node range per row. Arrows are bucketed by the
+// cells their bounding box touches. Coarser levels merge 2x2 cells into the clusters drawn
+// at low zoom.
+class GraphGrid {
+public:
+    struct Level {
+        int cols = 1;
+        int rows = 1;
+        float cellSize = 0.f;
+        std::vector<int> count;
+        std::vector<int> visited;
+        std::vector<sf::Vector2f> centroid;
+    };
+
+    struct CellRange {
+        int c0 = 0, c1 = -1, r0 = 0, r1 = -1;
+        bool empty() const { return c1 < c0 || r1 < r0; }
+    };
+
+    explicit GraphGrid(const std::vector<sf::Vector2f>& pos) {
+        int n = (int)pos.size();
+        sf::Vector2f lo(0.f, 0.f), hi(1.f, 1.f);
+        if (n > 0) {
+            lo = hi = pos[0];
+            for (sf::Vector2f p : pos) {
+                lo.x = std::min(lo.x, p.x); lo.y = std::min(lo.y, p.y);
+                hi.x = std::max(hi.x, p.x); hi.y = std::max(hi.y, p.y);
+            }
+        }
+        origin = lo;
+        extent = {std::max(hi.x - lo.x, 1.f), std::max(hi.y - lo.y, 1.f)};
+
+        // About eight nodes per cell, with the cell table capped at 1024x1024.
+        float cell = std::sqrt(extent.x * extent.y * 8.f / std::max(1, n));
+        cols = std::clamp((int)std::ceil(extent.x / cell), 1, 1024);
+        rows = std::clamp((int)std::ceil(extent.y / cell), 1, 1024);
+        cellSize = std::max(extent.x / cols, extent.y / rows) * 1.0001f;
+
+        nodeCell.resize(n);
+        cellStart.assign((size_t)cols * rows + 1, 0);
+        for (int v = 0; v < n; ++v) {
+            nodeCell[v] = cellOf(pos[v]);
+            cellStart[nodeCell[v] + 1]++;
+        }
+        for (size_t c = 0; c + 1 < cellStart.size(); ++c) cellStart[c + 1] += cellStart[c];
+        nodes.resize(n);
+        std::vector<int> fill(cellStart.begin(), cellStart.end() - 1);
+        for (int v = 0; v < n; ++v) nodes[fill[nodeCell[v]]++] = v;
+
+        for (int l = 0; l == 0 || levels.back().cols > 1 || levels.back().rows > 1; ++l) {
+            Level level;
+            level.cols = (cols + (1 << l) - 1) >> l;
+            level.rows = (rows + (1 << l) - 1) >> l;
+            level.cellSize = cellSize * (float)(1 << l);
+            level.count.assign((size_t)level.cols * level.rows, 0);
+            level.visited.assign(level.count.size(), 0);
+            level.centroid.assign(level.count.size(), {0.f, 0.f});
+            for (int v = 0; v < n; ++v) {
+                int c = levelCell(nodeCell[v], l, level.cols);
+                level.count[c]++;
+                level.centroid[c] += pos[v];
+            }
+            for (size_t c = 0; c < level.count.size(); ++c) {
+                if (level.count[c]) level.centroid[c] = level.centroid[c] / (float)level.count[c];
+            }
+            levels.push_back(std::move(level));
+        }
+    }
+
+    // Nodes sorted by cell; a renderer that draws in this order can cull by range.
+    const std::vector<int>& nodeOrder() const { return nodes; }
+
+    sf::FloatRect bounds() const { return {origin, extent}; }
+
+    // delta is -1 when a seek backwards un-visits v.
+    void markVisited(int v, int delta = 1) {
+        for (size_t l = 0; l < levels.size(); ++l) {
+            levels[l].visited[levelCell(nodeCell[v], (int)l, levels[l].cols)] += delta;
+        }
+    }
+
+    CellRange cellRange(const sf::FloatRect& rect, int level) const {
+        const Level& lv = levels[level];
+        CellRange r;
+        r.c0 = std::max(0, (int)std::floor((rect.position.x - origin.x) / lv.cellSize));
+        r.r0 = std::max(0, (int)std::floor((rect.position.y - origin.y) / lv.cellSize));
+        r.c1 = std::min(lv.cols - 1, (int)std::floor((rect.position.x + rect.size.x - origin.x) / lv.cellSize));
+        r.r1 = std::min(lv.rows - 1, (int)std::floor((rect.position.y + rect.size.y - origin.y) / lv.cellSize));
+        return r;
+    }
+
+    // Calls fn(first, count) with the draw-order node range of each visible grid row.
+    template <typename Fn>
+    void forVisibleNodeRuns(const sf::FloatRect& rect, Fn&& fn) const {
+        CellRange r = cellRange(rect, 0);
+        if (r.empty()) return;
+        for (int row = r.r0; row <= r.r1; ++row) {
+            int first = cellStart[(size_t)row * cols + r.c0];
+            int last = cellStart[(size_t)row * cols + r.c1 + 1];
+            if (last > first) fn((size_t)first, (size_t)(last - first));
+        }
+    }
+
+    void indexSegments(const std::vector<std::pair<sf::Vector2f, sf::Vector2f>>& segments) {
+        // Segments spanning many cells would bloat the buckets; they are tested directly.
+        const int kMaxSegmentCells = 64;
+        segmentStart.assign((size_t)cols * rows + 1, 0);
+        longSegments.clear();
+        segmentBox.resize(segments.size());
+        auto forCells = [&](uint32_t s, auto&& fn) {
+            CellRange r = cellRange(segmentBox[s], 0);
+            if (r.empty()) return;
+            if ((r.c1 - r.c0 + 1) * (r.r1 - r.r0 + 1) > kMaxSegmentCells) {
+                fn(-1);
+                return;
+            }
+            for (int row = r.r0; row <= r.r1; ++row)
+                for (int col = r.c0; col <= r.c1; ++col) fn(row * cols + col);
+        };
+        for (uint32_t s = 0; s < segments.size(); ++s) {
+            auto [a, b] = segments[s];
+            sf::Vector2f lo(std::min(a.x, b.x), std::min(a.y, b.y));
+            sf::Vector2f hi(std::max(a.x, b.x), std::max(a.y, b.y));
+            // Padded so axis-aligned arrows still have area, and to cover the arrowhead.
+            segmentBox[s] = sf::FloatRect(lo - sf::Vector2f(10.f, 10.f), hi - lo + sf::Vector2f(20.f, 20.f));
+            forCells(s, [&](int c) {
+                if (c < 0) longSegments.push_back(s);
+                else segmentStart[c + 1]++;
+            });
+        }
+        for (size_t c = 0; c + 1 < segmentStart.size(); ++c) segmentStart[c + 1] += segmentStart[c];
+        segmentIds.resize(segmentStart.back());
+        std::vector<uint32_t> fill(segmentStart.begin(), segmentStart.end() - 1);
+        for (uint32_t s = 0; s < segments.size(); ++s) {
+            forCells(s, [&](int c) {
+                if (c >= 0) segmentIds[fill[c]++] = s;
+            });
+        }
+        segmentStamp.assign(segments.size(), 0);
+        stamp = 0;
+    }
+
+    // Appends each segment whose bounding box meets rect exactly once, in ascending order.
+    void visibleSegments(const sf::FloatRect& rect, std::vector<uint32_t>& out) {
+        if (++stamp == 0) {
+            std::fill(segmentStamp.begin(), segmentStamp.end(), 0);
+            stamp = 1;
+        }
+        size_t before = out.size();
+        CellRange r = cellRange(rect, 0);
+        for (int row = r.r0; !r.empty() && row <= r.r1; ++row) {
+            for (int col = r.c0; col <= r.c1; ++col) {
+                size_t c = (size_t)row * cols + col;
+                for (uint32_t i = segmentStart[c]; i < segmentStart[c + 1]; ++i) {
+                    uint32_t s = segmentIds[i];
+                    if (segmentStamp[s] != stamp) {
+                        segmentStamp[s] = stamp;
+                        out.push_back(s);
+                    }
+                }
+            }
+        }
+        for (uint32_t s : longSegments) {
+            if (segmentStamp[s] != stamp && segmentBox[s].findIntersection(rect)) {
+                segmentStamp[s] = stamp;
+                out.push_back(s);
+            }
+        }
+        std::sort(out.begin() + before, out.end());
+    }
+
+    std::vector<Level> levels;
+
+private:
+    int cellOf(sf::Vector2f p) const {
+        int c = std::clamp((int)((p.x - origin.x) / cellSize), 0, cols - 1);
+        int r = std::clamp((int)((p.y - origin.y) / cellSize), 0, rows - 1);
+        return r * cols + c;
+    }
+
+    int levelCell(int baseCell, int level, int levelCols) const {
+        return ((baseCell / cols) >> level) * levelCols + ((baseCell % cols) >> level);
+    }
+
+    sf::Vector2f origin;
+    sf::Vector2f extent;
+    int cols = 1;
+    int rows = 1;
+    float cellSize = 1.f;
+    std::vector<int> nodeCell;
+    std::vector<int> cellStart;
+    std::vector<int> nodes;
+    std::vector<uint32_t> segmentStart;
+    std::vector<uint32_t> segmentIds;
+    std::vector<uint32_t> longSegments;
+    std::vector<sf::FloatRect> segmentBox;
+    std::vector<uint32_t> segmentStamp;
+    uint32_t stamp = 0;
+};
+
+// Draws nodes and arrows from two vertex batches. Each node owns 12 vertices (outline quad,
+// then fill quad) in the caller's draw order, and each arrow slot owns 9 (body quad, then head
+// triangle); only recoloured or re-aimed slots are touched between steps. Culled views submit
+// either node ranges straight from the batch or arrow slots gathered into a scratch array.
+class GraphRenderer {
+public:
+    static constexpr size_t kNodeVertices = 12;
+    static constexpr size_t kArrowVertices = 9;
+
+    GraphRenderer(const std::vector<sf::Vector2f>& pos, const std::vector<int>& drawOrder, float radius,
+                  sf::Color fill, sf::Color outline)
+        : radius(radius), nodeSlot(pos.size()) {
+        textured = makeDiscTexture(disc);
+        nodes.vertices.reserve(pos.size() * kNodeVertices);
+        for (size_t k = 0; k < drawOrder.size(); ++k) {
+            int v = drawOrder[k];
+            nodeSlot[v] = k;
+            appendQuad(nodes.vertices, pos[v], radius + 2.f, outline);
+            appendQuad(nodes.vertices, pos[v], radius, fill);
+        }
+    }
+
+    // Returns the slot index; arrows between overlapping nodes get an empty slot so slots
+    // stay aligned with the caller's numbering.
+    size_t addArrow(sf::Vector2f start, sf::Vector2f end, sf::Color color) {
+        size_t slot = arrowCount();
+        arrows.vertices.resize(arrows.vertices.size() + kArrowVertices);
+        writeArrow(slot, start, end, color);
+        return slot;
+    }
+
+    // Re-aims an existing slot; start == end empties it.
+    void placeArrow(size_t slot, sf::Vector2f start, sf::Vector2f end, sf::Color color) {
+        writeArrow(slot, start, end, color);
+        arrows.touch(slot * kArrowVertices, kArrowVertices);
+    }
+
+    void setArrowColor(size_t slot, sf::Color color) {
+        if (arrows.vertices[slot * kArrowVertices].position == arrows.vertices[slot * kArrowVertices + 1].position) return;
+        arrows.setColor(slot * kArrowVertices, kArrowVertices, color);
+    }
+
+    void setNodeColor(int node, sf::Color color) {
+        nodes.setColor(nodeSlot[node] * kNodeVertices + 6, 6, color);
+    }
+
+    size_t arrowCount() const { return arrows.vertices.size() / kArrowVertices; }
+
+    void upload() {
+        nodes.upload();
+        arrows.upload();
+    }
+
+    void drawArrows(sf::RenderTarget& target, size_t firstArrow, size_t arrowCount) {
+        arrows.draw(target, firstArrow * kArrowVertices, arrowCount * kArrowVertices, sf::RenderStates::Default);
+    }
+
+    void drawArrowSlots(sf::RenderTarget& target, const std::vector<uint32_t>& slots) {
+        scratch.clear();
+        for (uint32_t s : slots) {
+            const sf::Vertex* v = arrows.vertices.data() + s * kArrowVertices;
+            scratch.insert(scratch.end(), v, v + kArrowVertices);
+        }
+        if (!scratch.empty()) target.draw(scratch.data(), scratch.size(), sf::PrimitiveType::Triangles);
+    }
+
+    // Nodes are addressed by draw-order slot, matching the grid's node order.
+    void drawNodes(sf::RenderTarget& target, size_t firstSlot, size_t count) {
+        nodes.draw(target, firstSlot * kNodeVertices, count * kNodeVertices, discStates());
+    }
+
+    void drawDiscs(sf::RenderTarget& target, const std::vector<std::pair<sf::Vector2f, float>>& discs,
+                   const std::vector<sf::Color>& colors) {
+        scratch.clear();
+        for (size_t i = 0; i < discs.size(); ++i) appendQuad(scratch, discs[i].first, discs[i].second, colors[i]);
+        if (!scratch.empty()) target.draw(scratch.data(), scratch.size(), sf::PrimitiveType::Triangles, discStates());
+    }
+
+private:
+    void writeArrow(size_t slot, sf::Vector2f start, sf::Vector2f end, sf::Color color) {
+        const float nodeOffset = radius + 2.f;
+        const float headSize = 18.f;
+        const float halfThickness = 2.5f;
+        sf::Vertex* out = arrows.vertices.data() + slot * kArrowVertices;
+
+        sf::Vector2f dir = end - start;
+        float fullLen = std::sqrt(dir.x * dir.x + dir.y * dir.y);
+        if (fullLen <= 2.f * nodeOffset + 0.0001f) {
+            std::fill(out, out + kArrowVertices, sf::Vertex{start, sf::Color::Transparent});
+            return;
+        }
+        sf::Vector2f unit = dir / fullLen;
+        sf::Vector2f perp(-unit.y, unit.x);
+        sf::Vector2f a = start + unit * nodeOffset;
+        sf::Vector2f b = end - unit * nodeOffset;
+        sf::Vector2f back = b - unit * headSize;
+
+        for (sf::Vector2f v : {a + perp * halfThickness, b + perp * halfThickness, b - perp * halfThickness,
+                               a + perp * halfThickness, b - perp * halfThickness, a - perp * halfThickness,
+                               b, back + perp * (headSize / 2.f), back - perp * (headSize / 2.f)}) {
+            *out++ = sf::Vertex{v, color};
+        }
+    }
+
+    sf::RenderStates discStates() const {
+        sf::RenderStates states;
+        if (textured) states.texture = &disc;
+        return states;
+    }
+
+    void appendQuad(std::vector<sf::Vertex>& out, sf::Vector2f center, float half, sf::Color color) const {
+        // Without the disc texture nodes fall back to plain squares rather than disappearing.
+        float t = textured ? (float)disc.getSize().x : 0.f;
+        sf::Vertex corners[4] = {
+            {center + sf::Vector2f(-half, -half), color, {0.f, 0.f}},
+            {center + sf::Vector2f(half, -half), color, {t, 0.f}},
+            {center + sf::Vector2f(half, half), color, {t, t}},
+            {center + sf::Vector2f(-half, half), color, {0.f, t}},
+        };
+        for (int k : {0, 1, 2, 0, 2, 3}) out.push_back(corners[k]);
+    }
+
+    float radius;
+    bool textured = false;
+    sf::Texture disc;
+    std::vector<size_t> nodeSlot;
+    VertexBatch nodes;
+    VertexBatch arrows;
+    std::vector<sf::Vertex> scratch;
+};
+
+// Mouse-wheel zoom about the cursor, drag to pan, arrow keys, +/- and Home to refit.
+class PanZoomView {
+public:
+    void fit(const sf::FloatRect& bounds, sf::Vector2u windowSize) {
+        home = bounds;
+        float margin = 60.f;
+        float sx = (windowSize.x - 2.f * margin) / std::max(bounds.size.x, 1.f);
+        float sy = (windowSize.y - 2.f * margin) / std::max(bounds.size.y, 1.f);
+        float scale = std::max(std::min(sx, sy), 1e-6f);
+        view = sf::View(bounds.position + bounds.size / 2.f, sf::Vector2f((float)windowSize.x, (float)windowSize.y) / scale);
+        size = windowSize;
+    }
+
+    void handle(const sf::Event& ev, sf::RenderWindow& window) {
+        if (const auto* wheel = ev.getIf<sf::Event::MouseWheelScrolled>()) {
+            touched = true;
+            zoomAt(window, wheel->position, wheel->delta > 0 ? 1.f / 1.2f : 1.2f);
+        } else if (const auto* press = ev.getIf<sf::Event::MouseButtonPressed>()) {
+            dragging = true;
+            last = press->position;
+        } else if (ev.is<sf::Event::MouseButtonReleased>()) {
+            dragging = false;
+        } else if (const auto* move = ev.getIf<sf::Event::MouseMoved>()) {
+            if (dragging) {
+                touched = true;
+                view.move(window.mapPixelToCoords(last, view) - window.mapPixelToCoords(move->position, view));
+                last = move->position;
+            }
+        } else if (const auto* resized = ev.getIf<sf::Event::Resized>()) {
+            // Keep the zoom level; the window just shows more or less of the graph.
+            float scale = (float)size.y / view.getSize().y;
+            size = resized->size;
+            view.setSize(sf::Vector2f((float)size.x, (float)size.y) / scale);
+        } else if (const auto* key = ev.getIf<sf::Event::KeyPressed>()) {
+            sf::Vector2f step = view.getSize() / 10.f;
+            sf::Vector2i center((int)window.getSize().x / 2, (int)window.getSize().y / 2);
+            bool moved = true;
+            switch (key->code) {
+            case sf::Keyboard::Key::Left: view.move({-step.x, 0.f}); break;
+            case sf::Keyboard::Key::Right: view.move({step.x, 0.f}); break;
+            case sf::Keyboard::Key::Up: view.move({0.f, -step.y}); break;
+            case sf::Keyboard::Key::Down: view.move({0.f, step.y}); break;
+            case sf::Keyboard::Key::Equal:
+            case sf::Keyboard::Key::Add: zoomAt(window, center, 1.f / 1.2f); break;
+            case sf::Keyboard::Key::Hyphen:
+            case sf::Keyboard::Key::Subtract: zoomAt(window, center, 1.2f); break;
+            case sf::Keyboard::Key::Home:
+                fit(home, window.getSize());
+                touched = moved = false;
+                break;
+            default: moved = false; break;
+            }
+            touched |= moved;
+        }
+    }
+
+    sf::FloatRect visibleRect() const {
+        return {view.getCenter() - view.getSize() / 2.f, view.getSize()};
+    }
+
+    sf::View view;
+    bool touched = false;  // set once the user zooms or pans; Home hands control back
+
+private:
+    void zoomAt(const sf::RenderWindow& window, sf::Vector2i pixel, float factor) {
+        sf::Vector2f before = window.mapPixelToCoords(pixel, view);
+        view.zoom(factor);
+        view.move(before - window.mapPixelToCoords(pixel, view));
+    }
+
+    sf::FloatRect home;
+    sf::Vector2u size;
+    bool dragging = false;
+    sf::Vector2i last;
+};
+
+// Below kMinNodePixels of on-screen node radius the graph view switches to grid clusters.
+constexpr float kMinNodePixels = 3.f;
+constexpr float kClusterPixels = 16.f;
+
+// Above this many nodes the label batches would outweigh the geometry they annotate.
+constexpr int kMaxLabeledNodes = 2000;
+
+// Static labels laid out once from the font's glyph atlas into one vertex batch. Glyphs are
+// rasterised at kAtlasSize and scaled, so every label shares one texture and one draw call.
+// Text is only re-laid out when a value actually changes; visibility and zoom changes just
+// recolour slices, and labels that would be smaller than kMinPixels on screen are skipped.
+class LabelBatch {
+public:
+    static constexpr unsigned kAtlasSize = 32;
+    static constexpr float kMinPixels = 7.f;
+
+    explicit LabelBatch(const sf::Font& font) : font(font) {}
+
+    size_t add(sf::Vector2f center, unsigned size, sf::Color color, std::string text, bool visible = true) {
+        labels.push_back(Label{std::move(text), center, size, color, visible});
+        layoutDirty = true;
+        return labels.size() - 1;
+    }
+
+    void setText(size_t id, std::string text) {
+        if (labels[id].text == text) return;
+        labels[id].text = std::move(text);
+        layoutDirty = true;
+    }
+
+    // Moves a label without re-laying it out: its glyph quads are shifted in place.
+    void setCenter(size_t id, sf::Vector2f center) {
+        Label& label = labels[id];
+        if (label.center == center) return;
+        sf::Vector2f delta = center - label.center;
+        label.center = center;
+        if (layoutDirty || label.count == 0) return;
+        for (size_t v = label.first; v < label.first + label.count; ++v) glyphs.vertices[v].position += delta;
+        glyphs.touch(label.first, label.count);
+    }
+
+    void setVisible(size_t id, bool visible) {
+        Label& label = labels[id];
+        if (label.visible == visible) return;
+        label.visible = visible;
+        if (!layoutDirty) recolor(label);
+    }
+
+    void draw(sf::RenderTarget& target) {
+        // Screen pixels per world unit under the current view.
+        float scale = (float)target.getSize().y / target.getView().getSize().y;
+        float minSize = kMinPixels / scale;
+        if (layoutDirty) {
+            this->minSize = minSize;
+            layout();
+        } else if (minSize != this->minSize) {
+            bool changed = false;
+            for (const Label& label : labels) changed |= (label.size >= minSize) != (label.size >= this->minSize);
+            this->minSize = minSize;
+            if (changed) {
+                for (const Label& label : labels) recolor(label);
+            }
+        }
+        if (maxSize < minSize) return;
+        glyphs.draw(target, 0, glyphs.vertices.size(), sf::RenderStates(&font.getTexture(kAtlasSize)));
+    }
+
+private:
+    struct Label {
+        std::string text;
+        sf::Vector2f center;
+        unsigned size;
+        sf::Color color;
+        bool visible;
+        size_t first = 0;
+        size_t count = 0;
+    };
+
+    sf::Color shownColor(const Label& label) const {
+        return label.visible && label.size >= minSize ? label.color : sf::Color::Transparent;
+    }
+
+    void recolor(const Label& label) {
+        if (label.count) glyphs.setColor(label.first, label.count, shownColor(label));
+    }
+
+    void layout() {
+        glyphs.vertices.clear();
+        maxSize = 0;
+        for (Label& label : labels) {
+            label.first = glyphs.vertices.size();
+            maxSize = std::max(maxSize, (float)label.size);
+            sf::Color color = shownColor(label);
+            float k = (float)label.size / kAtlasSize;
+
+            // Pen positions in atlas units; the ink box is tracked so the label can be centred
+            // the way Text::getLocalBounds centring used to do it.
+            float pen = 0.f;
+            float left = 0.f, top = 0.f, right = 0.f, bottom = 0.f;
+            bool any = false;
+            uint32_t prev = 0;
+            for (unsigned char c : label.text) {
+                pen += font.getKerning(prev, c, kAtlasSize);
+                prev = c;
+                const sf::Glyph& glyph = font.getGlyph(c, kAtlasSize, false);
+                sf::FloatRect b = glyph.bounds;
+                if (b.size.x > 0.f && b.size.y > 0.f) {
+                    float x0 = pen + b.position.x, y0 = b.position.y;
+                    float x1 = x0 + b.size.x, y1 = y0 + b.size.y;
+                    if (!any) {
+                        left = x0; top = y0; right = x1; bottom = y1;
+                        any = true;
+                    } else {
+                        left = std::min(left, x0); top = std::min(top, y0);
+                        right = std::max(right, x1); bottom = std::max(bottom, y1);
+                    }
+                    sf::Vector2f uv((float)glyph.textureRect.position.x, (float)glyph.textureRect.position.y);
+                    sf::Vector2f uvSize((float)glyph.textureRect.size.x, (float)glyph.textureRect.size.y);
+                    sf::Vertex corners[4] = {
+                        {{x0, y0}, color, uv},
+                        {{x1, y0}, color, {uv.x + uvSize.x, uv.y}},
+                        {{x1, y1}, color, uv + uvSize},
+                        {{x0, y1}, color, {uv.x, uv.y + uvSize.y}},
+                    };
+                    for (int q : {0, 1, 2, 0, 2, 3}) glyphs.vertices.push_back(corners[q]);
+                }
+                pen += glyph.advance;
+            }
+
+            sf::Vector2f inkCenter((left + right) / 2.f, (top + bottom) / 2.f);
+            for (size_t v = label.first; v < glyphs.vertices.size(); ++v) {
+                sf::Vector2f& p = glyphs.vertices[v].position;
+                p = label.center + (p - inkCenter) * k;
+            }
+            label.count = glyphs.vertices.size() - label.first;
+        }
+        glyphs.upload();
+        layoutDirty = false;
+    }
+
+    const sf::Font& font;
+    std::vector<Label> labels;
+    VertexBatch glyphs;
+    bool layoutDirty = false;
+    float minSize = 0.f;
+    float maxSize = 0.f;
+};
+
+// The render side of a recorded trace: every vertex's state after the first position() events.
+// Seeking forward applies events and logs what each one overwrote, so seeking back just pops
+// the log and the algorithm never has to be rerun. Memory stays bounded on huge traces: only
+// the last kHistory..2*kHistory played events can be revisited (older ones are dropped together
+// with their undo entries, so first() moves up), and at most kAhead events are recorded past
+// the playhead; beyond that record() leaves them in the ring and the algorithm waits.
+class TraceTimeline {
+public:
+    // Reached means the vertex holds a tentative distance (or key) but is not queued.
+    enum class NodeState : uint8_t { Unseen, Frontier, Reached, Visited };
+
+    static constexpr size_t kHistory = size_t(1) << 21;
+    static constexpr size_t kAhead = size_t(1) << 21;
+
+    explicit TraceTimeline(int n) : states(n, NodeState::Unseen), parents(n, -1), values(n, LLONG_MAX) {}
+
+    // Drains what the ring holds, up to kAhead unplayed events; true once the ring is closed and empty.
+    bool record(EventRing& ring) {
+        size_t ahead = events.size() - undo.size();
+        return ring.drain(events, kAhead - std::min(ahead, kAhead));
+    }
+
+    // Positions are absolute event indices; [first(), end()] is what can still be seeked to.
+    size_t first() const { return base; }
+    size_t end() const { return base + events.size(); }
+    const TraceEvent& event(size_t i) const { return events[i - base]; }
+
+    size_t position() const { return base + undo.size(); }
+    NodeState state(int v) const { return states[v]; }
+    int parent(int v) const { return parents[v]; }
+    long long value(int v) const { return values[v]; }
+    // Vertex of the last applied event, or -1 at the start.
+    int current() const { return cur; }
+
+    // Calls changed(v) for every vertex whose state, parent, value or current-ness may have
+    // changed; current() already reports the target position during those calls.
+    template <typename Fn>
+    void seek(size_t target, Fn&& changed) {
+        target = std::clamp(target, base, end()) - base;
+        size_t start = undo.size();
+        int before = cur;
+        while (undo.size() < target) {
+            const TraceEvent& e = events[undo.size()];
+            int v = e.vertex();
+            undo.push_back(Undo{v, parents[v], cur, values[v], states[v]});
+            cur = v;
+            apply(e);
+        }
+        while (undo.size() > target) {
+            const Undo& u = undo.back();
+            states[u.v] = u.state;
+            parents[u.v] = u.parent;
+            values[u.v] = u.value;
+            cur = u.current;
+            undo.pop_back();
+        }
+        for (size_t i = std::min(start, target); i < std::max(start, target); ++i) changed(events[i].vertex());
+        if (before != cur && before != -1) changed(before);
+        if (cur != -1) changed(cur);
+        if (undo.size() >= 2 * kHistory) {
+            size_t drop = undo.size() - kHistory;
+            undo.erase(undo.begin(), undo.begin() + drop);
+            events.erase(events.begin(), events.begin() + drop);
+            base += drop;
+        }
+    }
+
+private:
+    struct Undo {
+        int v;
+        int parent;
+        int current;
+        long long value;
+        NodeState state;
+    };
+
+    void apply(const TraceEvent& e) {
+        int v = e.vertex();
+        NodeState& s = states[v];
+        switch (e.kind()) {
+        case TraceKind::Push:
+            if (s != NodeState::Visited) s = NodeState::Frontier;
+            break;
+        case TraceKind::Pop:
+            if (s == NodeState::Frontier) s = NodeState::Reached;
+            break;
+        case TraceKind::Visit:
+            s = NodeState::Visited;
+            break;
+        case TraceKind::Relax:
+            parents[v] = e.from;
+            values[v] = e.value;
+            if (s == NodeState::Unseen) s = NodeState::Reached;
+            break;
+        }
+    }
+
+    std::vector<NodeState> states;
+    std::vector<int> parents;
+    std::vector<long long> values;
+    std::vector<TraceEvent> events;
+    std::vector<Undo> undo;
+    size_t base = 0;
+    int cur = -1;
+};
+
+// Everything drawn in the graph view that depends on node positions: the grid index, the node
+// and arrow batches and the labels. It mirrors a TraceTimeline: arrow slot v is the current
+// tree edge into v, and refresh(v) restyles v after a seek. A layout update rebuilds the scene
+// from the timeline's current state.
+class GraphScene {
+public:
+    const float radius = 20.f;
+    const sf::Color unseenNodeColor = sf::Color(200, 200, 200);
+    const sf::Color frontierNodeColor = sf::Color(255, 165, 0);
+    const sf::Color reachedNodeColor = sf::Color(120, 160, 255);
+    const sf::Color visitedNodeColor = sf::Color::Cyan;
+    const sf::Color visitingArrowColor = sf::Color::Yellow;
+    const sf::Color visitedArrowColor = sf::Color::Red;
+    const sf::Color finalPathColor = sf::Color::Green;
+
+    GraphScene(const CsrGraph& graph, const TraceTimeline& timeline, const std::set<std::pair<int, int>>& pathEdges,
+               const std::vector<sf::Vector2f>& pos, const sf::Font& font, bool showDistances, bool completed)
+        : graph(graph), timeline(timeline), pathEdges(pathEdges), pos(pos), grid(pos),
+          renderer(pos, grid.nodeOrder(), radius, unseenNodeColor, sf::Color(240,240,240)),
+          labels(font), visited(graph.n, 0), arrowParent(graph.n, -1), completed(completed) {
+        int n = graph.n;
+        for (int v = 0; v < n; ++v) renderer.addArrow(pos[v], pos[v], sf::Color::Transparent);
+
+        // Tree edges change with every seek, so culling indexes every graph edge once and
+        // keeps the visible ones that are currently someone's tree edge.
+        std::vector<std::pair<sf::Vector2f, sf::Vector2f>> segments;
+        segments.reserve(graph.targets.size());
+        edgeSource.reserve(graph.targets.size());
+        for (int u = 0; u < n; ++u) {
+            for (long long e = graph.offsets[u]; e < graph.offsets[u + 1]; ++e) {
+                segments.push_back({pos[u], pos[graph.targets[e]]});
+                edgeSource.push_back(u);
+            }
+        }
+        grid.indexSegments(segments);
+
+        for (const auto& edge : pathEdges) {
+            pathLines.push_back(sf::Vertex{pos[edge.first], finalPathColor});
+            pathLines.push_back(sf::Vertex{pos[edge.second], finalPathColor});
+        }
+
+        if (n <= kMaxLabeledNodes) {
+            weightLabel.resize(n);
+            distanceLabel.assign(n, SIZE_MAX);
+            for (int i = 0; i < n; ++i) {
+                labels.add(pos[i], 18, sf::Color::Black, std::to_string(i + 1));
+                weightLabel[i] = labels.add(pos[i], 16, sf::Color::White, "", false);
+                if (showDistances) {
+                    distanceLabel[i] = labels.add(pos[i] + sf::Vector2f(0.f, radius + 12.f), 16, sf::Color::White, "");
+                }
+            }
+        }
+
+        for (int v = 0; v < n; ++v) refresh(v);
+        renderer.upload();
+    }
+
+    sf::FloatRect bounds() const { return grid.bounds(); }
+
+    // Restyles v from the timeline: node colour, its incoming tree arrow and its labels.
+    void refresh(int v) {
+        TraceTimeline::NodeState state = timeline.state(v);
+        bool isVisited = state == TraceTimeline::NodeState::Visited;
+        if (isVisited != (bool)visited[v]) {
+            visited[v] = isVisited;
+            grid.markVisited(v, isVisited ? 1 : -1);
+        }
+        switch (state) {
+        case TraceTimeline::NodeState::Unseen: renderer.setNodeColor(v, unseenNodeColor); break;
+        case TraceTimeline::NodeState::Frontier: renderer.setNodeColor(v, frontierNodeColor); break;
+        case TraceTimeline::NodeState::Reached: renderer.setNodeColor(v, reachedNodeColor); break;
+        case TraceTimeline::NodeState::Visited: renderer.setNodeColor(v, visitedNodeColor); break;
+        }
+
+        int p = timeline.parent(v);
+        sf::Color color = visitedArrowColor;
+        if (completed && pathEdges.count({p, v})) {
+            color = finalPathColor;
+        } else if (v == timeline.current()) {
+            color = visitingArrowColor;
+        }
+        if (p != arrowParent[v]) {
+            arrowParent[v] = p;
+            renderer.placeArrow(v, p != -1 ? pos[p] : pos[v], pos[v], color);
+        } else if (p != -1) {
+            renderer.setArrowColor(v, color);
+        }
+
+        if (weightLabel.empty()) return;
+        if (p != -1) {
+            sf::Vector2f dir = pos[v] - pos[p];
+            float len = std::sqrt(dir.x * dir.x + dir.y * dir.y);
+            bool fits = len > 2.f * (radius + 2.f);
+            if (fits) {
+                // MST trees are undirected, so a tree edge may only exist as v -> p.
+                long long e = findEdge(graph, p, v);
+                if (e < 0) e = findEdge(graph, v, p);
+                labels.setText(weightLabel[v], std::to_string(e < 0 ? 0 : graph.weights[e]));
+                labels.setCenter(weightLabel[v], (pos[p] + pos[v]) / 2.f + sf::Vector2f(-dir.y, dir.x) / len * 15.f);
+            }
+            labels.setVisible(weightLabel[v], fits);
+        } else {
+            labels.setVisible(weightLabel[v], false);
+        }
+        if (distanceLabel[v] != SIZE_MAX) {
+            long long d = timeline.value(v);
+            labels.setText(distanceLabel[v], "d = " + (d == LLONG_MAX ? std::string("inf") : std::to_string(d)));
+        }
+    }
+
+    // Once the whole trace has been replayed, the highlighted path turns green.
+    void setCompleted(bool done) {
+        if (completed == done) return;
+        completed = done;
+        for (const auto& edge : pathEdges) refresh(edge.second);
+    }
+
+    void draw(sf::RenderTarget& target, const sf::FloatRect& visible) {
+        float scale = (float)target.getSize().y / visible.size.y;
+        if ((radius + 2.f) * scale >= kMinNodePixels) {
+            // Only arrows and grid rows that meet the (padded) viewport are submitted.
+            sf::FloatRect padded(visible.position - sf::Vector2f(radius, radius) * 2.f,
+                                 visible.size + sf::Vector2f(radius, radius) * 4.f);
+            visibleEdges.clear();
+            grid.visibleSegments(padded, visibleEdges);
+            if (visibleEdges.size() == edgeSource.size()) {
+                renderer.drawArrows(target, 0, renderer.arrowCount());
+            } else {
+                // An edge's segment covers a tree edge in either direction.
+                visibleSlots.clear();
+                for (uint32_t e : visibleEdges) {
+                    int u = edgeSource[e], v = graph.targets[e];
+                    if (arrowParent[v] == u) visibleSlots.push_back(v);
+                    if (arrowParent[u] == v) visibleSlots.push_back(u);
+                }
+                std::sort(visibleSlots.begin(), visibleSlots.end());
+                visibleSlots.erase(std::unique(visibleSlots.begin(), visibleSlots.end()), visibleSlots.end());
+                renderer.drawArrowSlots(target, visibleSlots);
+            }
+            grid.forVisibleNodeRuns(padded, [&](size_t first, size_t count) {
+                renderer.drawNodes(target, first, count);
+            });
+            labels.draw(target);
+            return;
+        }
+
+        // Zoomed out: one disc per grid cell of the finest level that is still at least
+        // kClusterPixels across, sized by population and shaded by how much was visited.
+        int level = 0;
+        while (level + 1 < (int)grid.levels.size() && grid.levels[level].cellSize * scale < kClusterPixels) ++level;
+        const GraphGrid::Level& lv = grid.levels[level];
+        sf::FloatRect padded(visible.position - sf::Vector2f(lv.cellSize, lv.cellSize),
+                             visible.size + sf::Vector2f(lv.cellSize, lv.cellSize) * 2.f);
+        GraphGrid::CellRange r = grid.cellRange(padded, level);
+        clusterDiscs.clear();
+        clusterColors.clear();
+        for (int row = r.r0; !r.empty() && row <= r.r1; ++row) {
+            for (int col = r.c0; col <= r.c1; ++col) {
+                size_t c = (size_t)row * lv.cols + col;
+                if (lv.count[c] == 0) continue;
+                float px = std::min(lv.cellSize * scale * 0.45f, 3.f + 2.f * std::sqrt((float)lv.count[c]));
+                float t = (float)lv.visited[c] / lv.count[c];
+                auto mix = [t](uint8_t a, uint8_t b) { return (uint8_t)std::lround(a + (b - a) * t); };
+                clusterDiscs.push_back({lv.centroid[c], px / scale});
+                clusterColors.push_back(sf::Color(mix(unseenNodeColor.r, visitedNodeColor.r),
+                                                  mix(unseenNodeColor.g, visitedNodeColor.g),
+                                                  mix(unseenNodeColor.b, visitedNodeColor.b)));
+            }
+        }
+        renderer.drawDiscs(target, clusterDiscs, clusterColors);
+        if (completed && !pathLines.empty()) {
+            target.draw(pathLines.data(), pathLines.size(), sf::PrimitiveType::Lines);
+        }
+    }
+
+private:
+    const CsrGraph& graph;
+    const TraceTimeline& timeline;
+    const std::set<std::pair<int, int>>& pathEdges;
+    std::vector<sf::Vector2f> pos;
+    GraphGrid grid;
+    GraphRenderer renderer;
+    LabelBatch labels;
+    std::vector<char> visited;
+    std::vector<int> arrowParent;
+    std::vector<int> edgeSource;
+    std::vector<size_t> weightLabel;
+    std::vector<size_t> distanceLabel;
+    std::vector<sf::Vertex> pathLines;
+    bool completed;
+    std::vector<uint32_t> visibleEdges;
+    std::vector<uint32_t> visibleSlots;
+    std::vector<std::pair<sf::Vector2f, float>> clusterDiscs;
+    std::vector<sf::Color> clusterColors;
+};
+
+// Tree edges on the way from the source to dest; stops early if a negative cycle loops the
+// parent chain.
+std::set<std::pair<int, int>> pathEdgesTo(const std::vector<int>& parent, int dest) {
+    std::set<std::pair<int, int>> edges;
+    if (dest < 0 || dest >= (int)parent.size()) return edges;
+    for (int curr = dest; parent[curr] != -1; curr = parent[curr]) {
+        if (!edges.insert({parent[curr], curr}).second) break;
+    }
+    return edges;
+}
+
+std::string describeEvent(const TraceEvent& e) {
+    std::string node = std::to_string(e.vertex() + 1);
+    switch (e.kind()) {
+    case TraceKind::Visit: return "Visit node " + node;
+    case TraceKind::Push: return "Push node " + node;
+    case TraceKind::Pop: return "Pop node " + node;
+    case TraceKind::Relax:
+        if (e.from == -1) return "Start at node " + node;
+        return "Relax " + std::to_string(e.from + 1) + " -> " + node + " (" + std::to_string(e.value) + ")";
+    }
+    return "";
+}
+
+// Trace events replayed per second before any speed change.
+constexpr double kDefaultPlaybackRate = 8.0;
+
+std::string graphInfoString(const GraphAlgorithmInfo& algo, const GraphRun& run, int destIndex) {
+    if (!algo.shortestPath) {
+        return "Total MST Cost: " + std::to_string(run.totalCost);
+    } else if (isBfs(algo)) {
+        return "Total Cost: N/A (unweighted)";
+    } else {
+        if (destIndex != -1) {
+            std::string dStr = (run.dist[destIndex] == LLONG_MAX) ? "inf" : std::to_string(run.dist[destIndex]);
+            return "Shortest Path to Node " + std::to_string(destIndex + 1) + ": " + dStr;
+        }
+        return "Destination: Not Selected";
+    }
+}
+
+std::string metricsOverlayString(const MetricsSnapshot& m) {
+    if (!kMetricsEnabled) return "Metrics compiled out (GV_NO_METRICS)";
+    std::ostringstream out;
+    out << "Metrics (M to hide)\n";
+    for (int i = 0; i < kMetricCount; ++i) {
+        if (m.counts[i]) out << kMetricNames[i] << "  " << m.counts[i] << "\n";
+    }
+    out << std::fixed << std::setprecision(2);
+    for (int i = 0; i < kMetricTimerCount; ++i) {
+        if (m.nanos[i]) out << kMetricTimerNames[i] << "_ms  " << m.nanos[i] / 1e6 << "\n";
+    }
+    return out.str();
+}
+
+std::string traceStatusString(const TraceTimeline& timeline, bool finished, bool completed) {
+    size_t position = timeline.position();
+    std::string status = "Event " + std::to_string(position) + " / " + std::to_string(timeline.end());
+    if (!finished) status += "+";
+    if (position > timeline.first()) status += ": " + describeEvent(timeline.event(position - 1));
+    if (timeline.first() > 0) status += "  (history from " + std::to_string(timeline.first()) + ")";
+    if (completed) status += "  Done! Final path in green.";
+    return status;
+}
+
+// Title, info and status text plus the timeline bar, drawn in window pixels over the graph.
+class GraphHud {
+public:
+    GraphHud(const sf::Font& font, const std::string& title) : titleText(font), info(font), status(font), metrics(font) {
+        titleText.setString(title);
+        titleText.setCharacterSize(24);
+        titleText.setFillColor(sf::Color::White);
+        titleText.setStyle(sf::Text::Bold);
+        sf::FloatRect titleRect = titleText.getLocalBounds();
+        titleText.setOrigin({titleRect.position.x + titleRect.size.x / 2.0f,
+                             titleRect.position.y + titleRect.size.y / 2.0f});
+
+        info.setCharacterSize(20);
+        info.setFillColor(sf::Color::White);
+        info.setPosition({30.f, 70.f});
+
+        status.setCharacterSize(18);
+        status.setFillColor(sf::Color::White);
+
+        metrics.setCharacterSize(14);
+        metrics.setFillColor(sf::Color(200, 220, 255));
+        metricsPanel.setFillColor(sf::Color(0, 0, 0, 150));
+
+        barTrack.setFillColor(sf::Color(80, 80, 90));
+        barFill.setFillColor(sf::Color(120, 200, 255));
+        resize({800.f, 600.f});
+    }
+
+    void resize(sf::Vector2f size) {
+        this->size = size;
+        view = sf::View(sf::FloatRect({0.f, 0.f}, size));
+        titleText.setPosition({size.x / 2.f, 30.f});
+        status.setPosition({30.f, size.y - 80.f});
+        placeMetrics();
+        sf::FloatRect bar = barRect();
+        barTrack.setPosition(bar.position);
+        barTrack.setSize(bar.size);
+        barFill.setPosition(bar.position);
+    }
+
+    // The track spans everything recorded so far and the fill is the playhead.
+    sf::FloatRect barRect() const { return sf::FloatRect({30.f, size.y - 28.f}, {size.x - 60.f, 10.f}); }
+
+    void setProgress(size_t position, size_t total) {
+        sf::FloatRect bar = barRect();
+        barFill.setSize({total ? bar.size.x * position / total : 0.f, bar.size.y});
+    }
+
+    // The overlay sits in the top-right corner on a translucent panel sized to its text.
+    void setMetrics(const std::string& text) {
+        metrics.setString(text);
+        placeMetrics();
+    }
+
+    void draw(sf::RenderTarget& target) {
+        target.setView(view);
+        target.draw(titleText);
+        target.draw(info);
+        target.draw(status);
+        target.draw(barTrack);
+        target.draw(barFill);
+        if (showMetrics) {
+            target.draw(metricsPanel);
+            target.draw(metrics);
+        }
+    }
+
+    sf::View view;
+    sf::Text titleText;
+    sf::Text info;
+    sf::Text status;
+    bool showMetrics = false;
+
+private:
+    sf::Vector2f size;
+    sf::RectangleShape barTrack;
+    sf::RectangleShape barFill;
+    sf::Text metrics;
+    sf::RectangleShape metricsPanel;
+
+    void placeMetrics() {
+        sf::FloatRect bounds = metrics.getLocalBounds();
+        metrics.setPosition({size.x - bounds.size.x - 30.f, 70.f});
+        metricsPanel.setPosition({size.x - bounds.size.x - 38.f, 64.f});
+        metricsPanel.setSize({bounds.size.x + 16.f, bounds.size.y + bounds.position.y + 12.f});
+    }
+};
+
+// Shows the run an algorithm thread is streaming into `ring`. Events are drained into a
+// TraceTimeline every frame, and playback runs on the recorded trace, so it can be paused,
+// stepped, sped up or scrubbed while the algorithm is still going. `run` is only read once the
+// ring has been closed. The metrics overlay (M) shows the counters gathered since
+// `metricsBase`, live while the algorithm runs.
+void visualizeGraph(const CsrGraph& graph,
+                    EventRing& ring,
+                    const GraphRun& run,
+                    ForceLayout& layout,
+                    const GraphAlgorithmInfo& algo,
+                    int destIndex,
+                    const MetricsSnapshot& metricsBase)
+{
+    std::string title = algo.title;
+    sf::RenderWindow window(sf::VideoMode(sf::Vector2u{800u, 600u}), title);
+
+    sf::Font font;
+    if (!loadFont(font)) return;
+
+    bool showDistances = showsDistances(algo);
+
+    TraceTimeline timeline(graph.n);
+    std::set<std::pair<int, int>> shortestPathEdges;
+    bool finished = false;
+    bool completed = false;
+
+    std::vector<sf::Vector2f> pos;
+    uint64_t layoutVersion = 0;
+    layout.poll(pos, layoutVersion);
+    auto scene = std::make_unique<GraphScene>(graph, timeline, shortestPathEdges, pos, font, showDistances, completed);
+    sf::Clock layoutClock;
+    float rebuildSeconds = 0.f;
+    bool layoutSettled = false;
+
+    PanZoomView camera;
+    camera.fit(scene->bounds(), window.getSize());
+    GraphHud hud(font, title);
+    hud.info.setString("Running...");
+
+    auto seek = [&](size_t target) {
+        timeline.seek(target, [&](int v) { scene->refresh(v); });
+        bool done = finished && timeline.position() == timeline.end();
+        if (done != completed) {
+            completed = done;
+            scene->setCompleted(completed);
+        }
+    };
+
+    sf::Clock frameClock;
+    double playhead = 0.0;
+    double rate = kDefaultPlaybackRate;
+    bool paused = false;
+    bool scrubbing = false;
+    // Status is only rebuilt when something it shows changes.
+    size_t statusPosition = SIZE_MAX, statusTotal = SIZE_MAX;
+    double statusRate = 0.0;
+    bool statusPaused = false;
+    MetricsSnapshot shownMetrics;
+    bool metricsShown = false;
+
+    auto scrubTo = [&](sf::Vector2i pixel) {
+        sf::FloatRect bar = hud.barRect();
+        float t = std::clamp((window.mapPixelToCoords(pixel, hud.view).x - bar.position.x) / bar.size.x, 0.f, 1.f);
+        playhead = std::max(std::round((double)t * timeline.end()), (double)timeline.first());
+        seek((size_t)playhead);
+    };
+
+    while (window.isOpen()) {
+        for (auto ev = window.pollEvent(); ev.has_value(); ev = window.pollEvent()) {
+            if (ev->is<sf::Event::Closed>()) window.close();
+            if (const auto* resized = ev->getIf<sf::Event::Resized>()) {
+                hud.resize(sf::Vector2f((float)resized->size.x, (float)resized->size.y));
+            }
+            if (const auto* press = ev->getIf<sf::Event::MouseButtonPressed>()) {
+                sf::FloatRect bar = hud.barRect();
+                sf::FloatRect hit(bar.position - sf::Vector2f(0.f, 8.f), bar.size + sf::Vector2f(0.f, 16.f));
+                if (hit.contains(window.mapPixelToCoords(press->position, hud.view))) {
+                    scrubbing = true;
+                    scrubTo(press->position);
+                    continue;
+                }
+            }
+            if (scrubbing) {
+                if (const auto* move = ev->getIf<sf::Event::MouseMoved>()) {
+                    scrubTo(move->position);
+                    continue;
+                }
+                if (ev->is<sf::Event::MouseButtonReleased>()) {
+                    scrubbing = false;
+                    continue;
+                }
+            }
+            if (const auto* key = ev->getIf<sf::Event::KeyPressed>()) {
+                switch (key->code) {
+                case sf::Keyboard::Key::Space: paused = !paused; break;
+                case sf::Keyboard::Key::LBracket: rate = std::max(rate / 2.0, 0.5); break;
+                case sf::Keyboard::Key::RBracket: rate = std::min(rate * 2.0, 1e7); break;
+                case sf::Keyboard::Key::Period:
+                case sf::Keyboard::Key::Comma:
+                    paused = true;
+                    if (key->code == sf::Keyboard::Key::Period) {
+                        playhead = (double)std::min(timeline.position() + 1, timeline.end());
+                    } else {
+                        playhead = (double)(timeline.position() - (timeline.position() > 0));
+                    }
+                    seek((size_t)playhead);
+                    break;
+                case sf::Keyboard::Key::Backspace:
+                    playhead = (double)timeline.first();
+                    seek(timeline.first());
+                    break;
+                case sf::Keyboard::Key::End:
+                    playhead = (double)timeline.end();
+                    seek(timeline.end());
+                    break;
+                case sf::Keyboard::Key::M: hud.showMetrics = !hud.showMetrics; break;
+                default: break;
+                }
+            }
+            camera.handle(*ev, window);
+        }
+
+        if (!finished && timeline.record(ring)) {
+            finished = true;
+            shortestPathEdges = pathEdgesTo(run.parent, destIndex);
+            hud.info.setString(graphInfoString(algo, run, destIndex));
+            // The path set changed under the scene, so it is rebuilt below.
+            layoutClock.restart();
+            scene = std::make_unique<GraphScene>(graph, timeline, shortestPathEdges, pos, font, showDistances, completed);
+        }
+
+        // Streamed layout positions are taken at most ten times a second, and on big graphs no
+        // more often than keeps rebuilding under a fifth of the frame time. Until the user
+        // moves the camera it keeps following the growing layout. Once a poll has seen the
+        // layout converge, its positions are final and polling stops.
+        if (!layoutSettled && layoutClock.getElapsedTime().asSeconds() > std::max(0.1f, 5.f * rebuildSeconds)) {
+            bool converged = layout.converged();
+            if (layout.poll(pos, layoutVersion)) {
+                layoutClock.restart();
+                scene = std::make_unique<GraphScene>(graph, timeline, shortestPathEdges, pos, font, showDistances,
+                                                     completed);
+                if (!camera.touched) camera.fit(scene->bounds(), window.getSize());
+                rebuildSeconds = layoutClock.getElapsedTime().asSeconds();
+            }
+            layoutSettled = converged;
+        }
+
+        double dt = frameClock.restart().asSeconds();
+        if (!paused && !scrubbing) {
+            // The playhead waits at the end of what has been recorded so far, and never trails
+            // the oldest event still kept.
+            playhead = std::clamp(playhead + dt * rate, (double)timeline.first(), (double)timeline.end());
+            seek((size_t)playhead);
+        } else if (finished && !completed && timeline.position() == timeline.end()) {
+            seek(timeline.position());
+        }
+
+        size_t position = timeline.position(), total = timeline.end();
+        if (position != statusPosition || total != statusTotal || rate != statusRate || paused != statusPaused) {
+            statusPosition = position;
+            statusTotal = total;
+            statusRate = rate;
+            statusPaused = paused;
+            std::ostringstream speed;
+            speed << rate;
+            hud.status.setString(traceStatusString(timeline, finished, completed) + "\n" +
+                                 (paused ? "Paused" : "Playing") + " at " + speed.str() + " events/s"
+                                 "   Space pause  [ ] speed  , . step  Backspace restart  End jump  M metrics");
+            hud.setProgress(position, total);
+        }
+        if (hud.showMetrics) {
+            MetricsSnapshot metrics = metricsSnapshot() - metricsBase;
+            if (metrics.counts != shownMetrics.counts || metrics.nanos != shownMetrics.nanos || !metricsShown) {
+                shownMetrics = metrics;
+                metricsShown = true;
+                hud.setMetrics(metricsOverlayString(metrics));
+            }
+        }
+
+        window.clear(sf::Color(30,30,40));
+
+        window.setView(camera.view);
+        scene->draw(window, camera.visibleRect());
+
+        hud.draw(window);
+        window.display();
+    }
+}
+
+// Writes rendered frames on a background thread, either as numbered PNGs in a directory or as
+// one raw RGBA stream (a .rgba/.raw file, or - for stdout) ready to pipe into a video encoder.
+// At most kMaxQueuedFrames wait in the queue, so a slow disk throttles rendering rather than
+// filling memory; the PNGs of one batch are compressed in parallel on the shared pool.
+class FrameEncoder {
+public:
+    static constexpr size_t kMaxQueuedFrames = 8;
+
+    ~FrameEncoder() { finish(); }
+
+    bool open(const std::string& target) {
+        raw = target == "-" || target.ends_with(".rgba") || target.ends_with(".raw");
+        if (raw) {
+            out = target == "-" ? stdout : std::fopen(target.c_str(), "wb");
+            if (!out) {
+                std::cerr << "Error: Could not create '" << target << "'.\n";
+                return false;
+            }
+#if defined(_WIN32)
+            if (out == stdout) _setmode(_fileno(stdout), _O_BINARY);
+#endif
+        } else {
+            std::error_code ec;
+            std::filesystem::create_directories(target, ec);
+            if (ec) {
+                std::cerr << "Error: Could not create directory '" << target << "'.\n";
+                return false;
+            }
+            directory = target;
+        }
+        worker = std::thread([this] { encodeLoop(); });
+        return true;
+    }
+
+    // Blocks while the queue is full.
+    void push(sf::Image frame) {
+        std::unique_lock<std::mutex> lock(mutex);
+        space.wait(lock, [this] { return queue.size() < kMaxQueuedFrames; });
+        queue.push_back(std::move(frame));
+        ready.notify_one();
+    }
+
+    // Waits for every queued frame to be written; false if any write failed.
+    bool finish() {
+        if (worker.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                closing = true;
+            }
+            ready.notify_one();
+            worker.join();
+        }
+        if (out) {
+            ok = std::fflush(out) == 0 && ok;
+            if (out != stdout) ok = std::fclose(out) == 0 && ok;
+            out = nullptr;
+        }
+        return ok;
+    }
+
+    size_t framesWritten() const { return written; }
+    bool rawStream() const { return raw; }
+
+private:
+    void encodeLoop() {
+        std::vector<sf::Image> batch;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                ready.wait(lock, [this] { return !queue.empty() || closing; });
+                if (queue.empty()) return;
+                batch.assign(std::make_move_iterator(queue.begin()), std::make_move_iterator(queue.end()));
+                queue.clear();
+            }
+            space.notify_one();
+            // After a failed write the rest are still taken off the queue so push() never stalls.
+            if (!ok) continue;
+            if (raw) {
+                for (const sf::Image& frame : batch) {
+                    size_t bytes = (size_t)frame.getSize().x * frame.getSize().y * 4;
+                    ok = ok && std::fwrite(frame.getPixelsPtr(), 1, bytes, out) == bytes;
+                }
+            } else {
+                std::vector<char> saved(batch.size(), 0);
+                sharedThreadPool().parallelFor(0, (long long)batch.size(), 1, [&](long long lo, long long hi, unsigned) {
+                    for (long long i = lo; i < hi; ++i) {
+                        char name[32];
+                        std::snprintf(name, sizeof(name), "frame_%06zu.png", written + (size_t)i);
+                        saved[i] = batch[i].saveToFile(std::filesystem::path(directory) / name);
+                    }
+                });
+                ok = std::all_of(saved.begin(), saved.end(), [](char s) { return s != 0; });
+            }
+            if (!ok) {
+                std::cerr << "Error: Could not write frames from " << written << " on.\n";
+                continue;
+            }
+            written += batch.size();
+        }
+    }
+
+    bool raw = false;
+    FILE* out = nullptr;
+    std::string directory;
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::condition_variable space;
+    std::deque<sf::Image> queue;
+    bool closing = false;
+    bool ok = true;
+    size_t written = 0;
+};
+
+struct FrameExportOptions {
+    std::string target;
+    sf::Vector2u size{1280u, 720u};
+    size_t eventsPerFrame = 1;
+};
+
+// Offscreen counterpart of visualizeGraph for machines without a display: the layout is run to
+// convergence, then the algorithm streams its trace while one frame is rendered into a
+// RenderTexture every `eventsPerFrame` events, with no display pacing. A last frame shows the
+// finished run with its path.
+bool exportGraphAnimation(const CsrGraph& graph, const GraphAlgorithmInfo& algo, int source, int destIndex,
+                          const FrameExportOptions& options) {
+    sf::Font font;
+    if (!loadFont(font)) return false;
+    sf::RenderTexture target;
+    if (!target.resize(options.size)) {
+        std::cerr << "Error: Could not create a " << options.size.x << "x" << options.size.y << " render texture.\n";
+        return false;
+    }
+    FrameEncoder encoder;
+    if (!encoder.open(options.target)) return false;
+
+    ForceLayout layout(graph);
+    layout.start();
+    layout.wait();
+    std::vector<sf::Vector2f> pos;
+    uint64_t layoutVersion = 0;
+    layout.poll(pos, layoutVersion);
+    GraphContext ctx{graph, pos};
+
+    EventRing ring;
+    GraphRun run;
+    std::thread worker([&] {
+        run = runGraphAlgorithm(algo, ctx, source, destIndex, &ring);
+        ring.close();
+    });
+
+    std::string title = algo.title;
+    bool showDistances = showsDistances(algo);
+    TraceTimeline timeline(graph.n);
+    std::set<std::pair<int, int>> shortestPathEdges;
+    bool finished = false;
+    bool completed = false;
+    auto scene = std::make_unique<GraphScene>(graph, timeline, shortestPathEdges, pos, font, showDistances, completed);
+
+    PanZoomView camera;
+    camera.fit(scene->bounds(), options.size);
+    GraphHud hud(font, title);
+    hud.resize(sf::Vector2f((float)options.size.x, (float)options.size.y));
+    hud.info.setString("Running...");
+
+    auto render = [&] {
+        hud.status.setString(traceStatusString(timeline, finished, completed));
+        hud.setProgress(timeline.position(), timeline.end());
+        target.clear(sf::Color(30,30,40));
+        target.setView(camera.view);
+        scene->draw(target, camera.visibleRect());
+        hud.draw(target);
+        target.display();
+        encoder.push(target.getTexture().copyToImage());
+    };
+
+    size_t step = std::max<size_t>(1, options.eventsPerFrame);
+    render();
+    for (;;) {
+        if (!finished && timeline.record(ring)) {
+            finished = true;
+            shortestPathEdges = pathEdgesTo(run.parent, destIndex);
+            hud.info.setString(graphInfoString(algo, run, destIndex));
+            scene = std::make_unique<GraphScene>(graph, timeline, shortestPathEdges, pos, font, showDistances, completed);
+        }
+        size_t position = timeline.position(), total = timeline.end();
+        if (position + step <= total || (finished && position < total)) {
+            timeline.seek(std::min(position + step, total), [&](int v) { scene->refresh(v); });
+            render();
+        } else if (finished) {
+            break;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    worker.join();
+    completed = true;
+    scene->setCompleted(true);
+    render();
+
+    bool ok = encoder.finish();
+    // Keep stdout clean when it carries the frames.
+    std::ostream& report = options.target == "-" ? std::cerr : std::cout;
+    report << "frames: " << encoder.framesWritten() << " (" << options.size.x << "x" << options.size.y
+           << (encoder.rawStream() ? " RGBA" : " PNG") << ")\n";
+    report << "events: " << timeline.end() << "\n";
+    return ok;
+}
+
+void runGraphAlgorithmsOn(const CsrGraph& graph) {
+    int n = graph.n;
+    // The layout starts right away so it converges while the prompts are answered.
+    ForceLayout layout(graph);
+    layout.start();
+
+    std::cout << "Choose algorithm:\n";
+    int algoCount = (int)std::size(kGraphAlgorithms);
+    for (int i = 0; i < algoCount; ++i) {
+        std::cout << (i + 1) << ". " << kGraphAlgorithms[i].menuLabel << "\n";
+    }
+    std::cout << "> ";
+    int ch; std::cin >> ch;
+    if (ch < 1 || ch > algoCount) {
+        std::cerr << "Invalid choice\n";
+        return;
+    }
+    const GraphAlgorithmInfo& algo = kGraphAlgorithms[ch - 1];
+
+    int destIndex = -1;
+    if (algo.needsDestination) {
+        std::cout << algo.menuLabel << " requires a destination.\n";
+        std::cout << "Enter destination node (1-" << n << "): ";
+        int destNode;
+        if (!(std::cin >> destNode) || destNode < 1 || destNode > n) {
+            std::cerr << "Invalid destination node.\n";
+            return;
+        }
+        destIndex = destNode - 1;
+    } else if (algo.shortestPath) {
+        // Asked up front now, since the window opens while the algorithm is still running.
+        std::cout << "Enter destination node (1-" << n << ") to highlight path (0 for none): ";
+        int destNode;
+        if (!(std::cin >> destNode) || destNode < 0 || destNode > n) {
+            std::cerr << "Invalid destination node.\n";
+            return;
+        }
+        destIndex = destNode - 1;
+    }
+
+    // The Euclidean A* heuristic reads node coordinates, so it waits for the settled layout.
+    if (algo.id == GraphAlgorithm::AStar) layout.wait();
+    std::vector<sf::Vector2f> pos;
+    uint64_t layoutVersion = 0;
+    layout.poll(pos, layoutVersion);
+    GraphContext ctx{graph, pos};
+
+    // The algorithm runs on its own thread and streams its trace to the window.
+    EventRing ring;
+    GraphRun run;
+    MetricsSnapshot metricsBase = metricsSnapshot();
+    std::thread worker([&] {
+        run = runGraphAlgorithm(algo, ctx, 0, destIndex, &ring);
+        ring.close();
+    });
+    visualizeGraph(graph, ring, run, layout, algo, destIndex, metricsBase);
+    ring.abandon();
+    worker.join();
+
+    const std::vector<int>& order = run.order;
+    const std::vector<int>& parent = run.parent;
+
+    if (run.negativeCycle) {
+        std::cout << "\n\n*** WARNING: Negative weight cycle detected! ***\n";
+        std::cout << "Shortest paths are not well-defined.\n\n";
+    }
+
+    if (algo.shortestPath && destIndex > 0 && parent[destIndex] == -1) {
+        std::cout << "Node " << (destIndex + 1) << " is not reachable from node 1.\n";
+    }
+
+    std::cout << "\nTraversal/Visit order: ";
+    for (size_t i = 0; i < order.size(); ++i) {
+        std::cout << (order[i] + 1);
+        if (i + 1 < order.size()) std::cout << " -> ";
+    }
+    std::cout << "\n\nVisited nodes (step by step):\n";
+    for (auto v : order) std::cout << "Node " << (v+1) << "\n";
+}
+
+void runGraphAlgorithms() {
+    int n;
+    std::cout << "Enter number of nodes (max 10 recommended): ";
+    if (!(std::cin >> n) || n <= 0) {
+        std::cerr << "Invalid number\n";
+        return;
+    }
+
+    std::vector<std::vector<int>> matrix(n, std::vector<int>(n));
+    std::cout << "Enter adjacency matrix (" << n << "x" << n << "), 0 for no edge:\n";
+    std::cout << "(Use negative numbers for Bellman-Ford)\n";
+    for (int i = 0; i < n; ++i)
+        for (int j = 0; j < n; ++j)
+            std::cin >> matrix[i][j];
+
+    runGraphAlgorithmsOn(csrFromMatrix(matrix));
+}
+
+using HuffmanFrequencies = std::array<uint64_t, 256>;
+using CodeLengths = std::array<uint8_t, 256>;
+
+// Keeps every code inside one root-table probe of the decoder.
+constexpr int kMaxHuffmanCodeLength = 12;
+
+// Four interleaved histograms so runs of one byte do not serialize on a single counter.
+HuffmanFrequencies countSymbols(std::string_view text) {
+    std::array<std::array<uint32_t, 256>, 4> partial{};
+    HuffmanFrequencies freq{};
+    const unsigned char* p = (const unsigned char*)text.data();
+    size_t size = text.size(), i = 0;
+    while (i < size) {
+        // Flush before a 32-bit counter can overflow.
+        size_t stop = std::min(size, i + ((size_t)1 << 30));
+        for (; i + 4 <= stop; i += 4) {
+            partial[0][p[i]]++;
+            partial[1][p[i + 1]]++;
+            partial[2][p[i + 2]]++;
+            partial[3][p[i + 3]]++;
+        }
+        for (; i < stop; ++i) partial[0][p[i]]++;
+        for (auto& counts : partial) {
+            for (int s = 0; s < 256; ++s) freq[s] += counts[s];
+            counts.fill(0);
+        }
+    }
+    return freq;
+}
+
+// Optimal unlimited code lengths by the two-queue method: sorted leaves form one queue and merged nodes, created
+// in non-decreasing weight order, the other. Node ids index fixed arrays, so nothing is allocated.
+CodeLengths huffmanCodeLengths(const HuffmanFrequencies& freq) {
+    CodeLengths lengths{};
+    std::array<int, 256> order;
+    int n = 0;
+    for (int s = 0; s < 256; ++s) {
+        if (freq[s]) order[n++] = s;
+    }
+    if (n <= 2) {
+        for (int i = 0; i < n; ++i) lengths[order[i]] = 1;
+        return lengths;
+    }
+    std::sort(order.begin(), order.begin() + n, [&](int a, int b) { return freq[a] < freq[b] || (freq[a] == freq[b] && a < b); });
+
+    // Ids below n are leaves in sorted order, id n + k is the k-th merged node.
+    std::array<uint64_t, 255> merged;
+    std::array<int, 511> parent, depth;
+    int nextLeaf = 0, nextMerged = 0;
+    auto weight = [&](int id) { return id < n ? freq[order[id]] : merged[id - n]; };
+    auto pop = [&](int created) {
+        if (nextLeaf < n && (nextMerged == created || freq[order[nextLeaf]] <= merged[nextMerged])) return nextLeaf++;
+        return n + nextMerged++;
+    };
+    for (int k = 0; k < n - 1; ++k) {
+        int a = pop(k), b = pop(k);
+        merged[k] = weight(a) + weight(b);
+        parent[a] = parent[b] = n + k;
+    }
+
+    // Parents are created after their children, so walking ids downward sees every parent's depth first.
+    int root = 2 * n - 2;
+    depth[root] = 0;
+    for (int id = root - 1; id >= 0; --id) depth[id] = depth[parent[id]] + 1;
+    for (int i = 0; i < n; ++i) lengths[order[i]] = (uint8_t)depth[i];
+    return lengths;
+}
+
+// Optimal code lengths no longer than maxLength, by package-merge: each level pairs up the lightest items
+// of the level below and merges the packages back in with the leaves; a leaf's length is the number of
+// times it appears under the 2n-2 lightest items of the last level.
+CodeLengths packageMergeCodeLengths(const HuffmanFrequencies& freq, int maxLength) {
+    CodeLengths lengths{};
+    std::vector<int> symbols;
+    for (int s = 0; s < 256; ++s) {
+        if (freq[s]) symbols.push_back(s);
+    }
+    if (symbols.size() <= 2) {
+        for (int s : symbols) lengths[s] = 1;
+        return lengths;
+    }
+    std::stable_sort(symbols.begin(), symbols.end(), [&](int a, int b) { return freq[a] < freq[b]; });
+
+    struct Item {
+        uint64_t weight;
+        int symbol, left, right;
+    };
+    std::vector<Item> leaves;
+    for (int s : symbols) leaves.push_back({freq[s], s, -1, -1});
+
+    std::vector<std::vector<Item>> levels(maxLength);
+    levels[0] = leaves;
+    for (int d = 1; d < maxLength; ++d) {
+        const std::vector<Item>& below = levels[d - 1];
+        std::vector<Item>& level = levels[d];
+        size_t leaf = 0, pair = 0, pairs = below.size() / 2;
+        while (leaf < leaves.size() || pair < pairs) {
+            uint64_t packageWeight = pair < pairs ? below[2 * pair].weight + below[2 * pair + 1].weight : 0;
+            if (pair == pairs || (leaf < leaves.size() && leaves[leaf].weight <= packageWeight)) {
+                level.push_back(leaves[leaf++]);
+            } else {
+                level.push_back({packageWeight, -1, (int)(2 * pair), (int)(2 * pair + 1)});
+                ++pair;
+            }
+        }
+    }
+
+    std::function<void(int, int)> take = [&](int d, int index) {
+        const Item& item = levels[d][index];
+        if (item.symbol >= 0) {
+            lengths[item.symbol]++;
+        } else {
+            take(d - 1, item.left);
+            take(d - 1, item.right);
+        }
+    };
+    for (int i = 0; i < 2 * (int)symbols.size() - 2; ++i) take(maxLength - 1, i);
+    return lengths;
+}
+
+// Plain Huffman lengths are already optimal when they fit; only skewed models pay for package-merge.
+CodeLengths limitedCodeLengths(const HuffmanFrequencies& freq, int maxLength = kMaxHuffmanCodeLength) {
+    CodeLengths lengths = huffmanCodeLengths(freq);
+    if (*std::max_element(lengths.begin(), lengths.end()) <= maxLength) return lengths;
+    return packageMergeCodeLengths(freq, maxLength);
+}
+
+struct HuffmanCode {
+    uint64_t bits = 0;
+    int length = 0;
+};
+
+using HuffmanCodeTable = std::array<HuffmanCode, 256>;
+
+// Canonical assignment: shorter codes first, ties by symbol value, so the lengths alone define the codes.
+HuffmanCodeTable canonicalCodes(const CodeLengths& lengths) {
+    std::array<uint64_t, 64> lengthCount{}, nextCode{};
+    for (uint8_t length : lengths) lengthCount[length]++;
+    lengthCount[0] = 0;
+    for (int length = 1; length < 64; ++length) {
+        nextCode[length] = (nextCode[length - 1] + lengthCount[length - 1]) << 1;
+    }
+    HuffmanCodeTable table{};
+    for (int s = 0; s < 256; ++s) {
+        if (lengths[s] == 0) continue;
+        table[s].length = lengths[s];
+        table[s].bits = nextCode[lengths[s]]++;
+    }
+    return table;
+}
+
+std::map<char, std::string> codeStrings(const HuffmanCodeTable& table) {
+    std::map<char, std::string> codes;
+    for (int s = 0; s < 256; ++s) {
+        for (int i = table[s].length - 1; i >= 0; --i) codes[(char)s] += (table[s].bits >> i) & 1 ? '1' : '0';
+    }
+    return codes;
+}
+
+struct HuffmanTreeNode {
+    uint64_t freq = 0;
+    int symbol = -1;  // -1 for internal nodes
+    int left = -1, right = -1;
+};
+
+// Node 0 is the root; any prefix code over bytes fits in 511 nodes.
+struct HuffmanTree {
+    std::array<HuffmanTreeNode, 511> nodes;
+    int size = 1;
+};
+
+// Rebuilds the tree the canonical codes describe, for drawing; internal nodes carry their subtree's weight.
+HuffmanTree codeTree(const HuffmanCodeTable& table, const HuffmanFrequencies& freq) {
+    HuffmanTree tree;
+    for (int s = 0; s < 256; ++s) {
+        if (table[s].length == 0) continue;
+        int node = 0;
+        tree.nodes[0].freq += freq[s];
+        for (int i = table[s].length - 1; i >= 0; --i) {
+            int& child = ((table[s].bits >> i) & 1) ? tree.nodes[node].right : tree.nodes[node].left;
+            if (child < 0) child = tree.size++;
+            node = child;
+            tree.nodes[node].freq += freq[s];
+        }
+        tree.nodes[node].symbol = s;
+    }
+    return tree;
+}
+
+// Packs codes MSB-first into big-endian 32-bit words; out must have room for the whole stream.
+class BitWriter {
+public:
+    explicit BitWriter(uint8_t* out) : out(out) {}
+
+    void put(uint64_t code, int length) {
+        if (length > 32) {
+            put(code >> 32, length - 32);
+            code &= 0xffffffffu;
+            length = 32;
+        }
+        buffer = (buffer << length) | code;
+        count += length;
+        if (count >= 32) {
+            count -= 32;
+            uint32_t word = (uint32_t)(buffer >> count);
+            out[0] = (uint8_t)(word >> 24);
+            out[1] = (uint8_t)(word >> 16);
+            out[2] = (uint8_t)(word >> 8);
+            out[3] = (uint8_t)word;
+            out += 4;
+        }
+    }
+
+    // Pads the last byte with zero bits and returns one past the last byte written.
+    uint8_t* finish() {
+        while (count >= 8) {
+            count -= 8;
+            *out++ = (uint8_t)(buffer >> count);
+        }
+        if (count > 0) *out++ = (uint8_t)(buffer << (8 - count));
+        count = 0;
+        return out;
+    }
+
+private:
+    uint8_t* out;
+    uint64_t buffer = 0;
+    int count = 0;
+};
+
+struct PackedBits {
+    std::vector<uint8_t> bytes;
+    size_t bitCount = 0, symbolCount = 0;
+
+    bool bit(size_t i) const { return (bytes[i >> 3] >> (7 - (i & 7))) & 1; }
+};
+
+void encodeHuffmanInto(std::string_view text, const HuffmanCodeTable& table, uint8_t* out) {
+    GV_TIME(Encode);
+    GV_COUNT(BytesEncoded, text.size());
+    BitWriter writer(out);
+    for (unsigned char c : text) writer.put(table[c].bits, table[c].length);
+    writer.finish();
+}
+
+PackedBits encodeHuffman(std::string_view text, const HuffmanCodeTable& table) {
+    PackedBits packed;
+    packed.symbolCount = text.size();
+    for (unsigned char c : text) packed.bitCount += table[c].length;
+    packed.bytes.resize((packed.bitCount + 7) / 8);
+    encodeHuffmanInto(text, table, packed.bytes.data());
+    return packed;
+}
+
+std::string bitString(const PackedBits& packed) {
+    std::string s(packed.bitCount, '0');
+    for (size_t i = 0; i < packed.bitCount; ++i) {
+        if (packed.bit(i)) s[i] = '1';
+    }
+    return s;
+}
+
+inline uint64_t loadBigEndian64(const uint8_t* p) {
+    return (uint64_t)p[0] << 56 | (uint64_t)p[1] << 48 | (uint64_t)p[2] << 40 | (uint64_t)p[3] << 32 |
+           (uint64_t)p[4] << 24 | (uint64_t)p[5] << 16 | (uint64_t)p[6] << 8 | (uint64_t)p[7];
+}
+
+// MSB-first reader over one bitstream, reading zeros past its end.
+struct HuffmanBitReader {
+    const uint8_t* data = nullptr;
+    size_t size = 0, pos = 0;
+    uint64_t buffer = 0;  // valid bits MSB-aligned
+    int avail = 0;
+
+    HuffmanBitReader() = default;
+    explicit HuffmanBitReader(std::span<const uint8_t> bits) : data(bits.data()), size(bits.size()) {}
+
+    bool canRefillFast() const { return pos + 8 <= size; }
+
+    // Branch-free top-up to at least 56 bits; needs canRefillFast().
+    void refillFast() {
+        buffer |= loadBigEndian64(data + pos) >> avail;
+        pos += (63 - avail) >> 3;
+        avail |= 56;
+    }
+
+    // Keeps at least 56 valid bits in buffer.
+    void refill() {
+        if (canRefillFast()) {
+            refillFast();
+            return;
+        }
+        while (avail <= 56) {
+            uint64_t byte = pos < size ? data[pos] : 0;
+            ++pos;
+            buffer |= byte << (56 - avail);
+            avail += 8;
+        }
+    }
+
+    void consume(int bits) {
+        buffer <<= bits;
+        avail -= bits;
+    }
+
+    uint64_t consumedBits() const { return pos * 8 - avail; }
+};
+
+struct HuffmanDecodeEntry {
+    uint8_t symbol[2] = {};
+    uint8_t count = 0;        // symbols decoded by this entry; 0 when no code starts with these bits
+    uint8_t length = 0;       // bits consumed
+    uint8_t firstLength = 0;  // bits of symbol[0] alone
+};
+
+// One lookup table indexed by the next kRootBits bits, decoding one or two symbols per probe. Code
+// lengths are capped at kMaxHuffmanCodeLength, by the encoder and by the payload header check, so
+// every code fits in a single probe.
+class HuffmanDecoder {
+public:
+    static constexpr int kRootBits = kMaxHuffmanCodeLength;
+
+    explicit HuffmanDecoder(const HuffmanCodeTable& table) {
+        entries.resize(size_t(1) << kRootBits);
+        for (int s = 0; s < 256; ++s) {
+            const HuffmanCode& code = table[s];
+            if (code.length == 0 || code.length > kRootBits) continue;
+            size_t first = (size_t)code.bits << (kRootBits - code.length);
+            for (size_t i = 0; i < (size_t(1) << (kRootBits - code.length)); ++i) {
+                HuffmanDecodeEntry& e = entries[first + i];
+                e.symbol[0] = (uint8_t)s;
+                e.count = 1;
+                e.length = e.firstLength = (uint8_t)code.length;
+            }
+        }
+        pairRootEntries();
+    }
+
+    // Decodes exactly count symbols into out; false if the stream is corrupt or too short.
+    bool decode(std::span<const uint8_t> bits, uint8_t* out, size_t count) const {
+        HuffmanBitReader reader(bits);
+        return decodeRun(reader, out, out + count) && reader.consumedBits() <= bits.size() * 8;
+    }
+
+    // Stream j decodes out[bounds[j], bounds[j + 1]). Four streams advanced in one loop give the CPU four
+    // independent lookup chains to overlap; eight-stream payloads run as two groups of four, since eight readers
+    // no longer fit in registers.
+    bool decodeStreams(const std::span<const uint8_t>* streams, int count, uint8_t* out, const size_t* bounds) const {
+        if (count == 1) return decode(streams[0], out + bounds[0], bounds[1] - bounds[0]);
+        for (int j = 0; j < count; j += 4) {
+            if (!decodeFourStreams(streams + j, out, bounds + j)) return false;
+        }
+        return true;
+    }
+
+private:
+    std::vector<HuffmanDecodeEntry> entries;
+
+    bool decodeFourStreams(const std::span<const uint8_t>* streams, uint8_t* out, const size_t* bounds) const {
+        const HuffmanDecodeEntry* root = entries.data();
+        HuffmanBitReader r0(streams[0]), r1(streams[1]), r2(streams[2]), r3(streams[3]);
+        uint8_t *o0 = out + bounds[0], *o1 = out + bounds[1], *o2 = out + bounds[2], *o3 = out + bounds[3];
+        uint8_t *e0 = o1, *e1 = o2, *e2 = o3, *e3 = out + bounds[4];
+
+        // A bit pattern no code starts with ends the hot loop, and decodeRun then reports it. Keeping the step free
+        // of calls lets the four readers live in registers.
+        auto step = [&](HuffmanBitReader& r, uint8_t*& o) {
+            HuffmanDecodeEntry e = root[r.buffer >> (64 - kRootBits)];
+            if (e.count == 0) return false;
+            o[0] = e.symbol[0];
+            o[1] = e.symbol[1];
+            o += e.count;
+            r.consume(e.length);
+            return true;
+        };
+        // A round refills each reader (at most 7 bytes of input) and writes at most 8 symbols per stream, so the
+        // bounds are checked once per batch of rounds rather than every round.
+        auto rounds = [](const HuffmanBitReader& r, const uint8_t* o, const uint8_t* e) {
+            size_t input = r.canRefillFast() ? (r.size - r.pos - 8) / 7 + 1 : 0;
+            return std::min<size_t>(input, (size_t)(e - o) / 8);
+        };
+        bool rootOnly = true;
+        while (rootOnly) {
+            size_t batch = std::min(std::min(rounds(r0, o0, e0), rounds(r1, o1, e1)),
+                                    std::min(rounds(r2, o2, e2), rounds(r3, o3, e3)));
+            if (batch == 0) break;
+            for (size_t k = 0; k < batch && rootOnly; ++k) {
+                r0.refillFast();
+                r1.refillFast();
+                r2.refillFast();
+                r3.refillFast();
+                for (int i = 0; i < 4 && rootOnly; ++i) {
+                    rootOnly = step(r0, o0) && step(r1, o1) && step(r2, o2) && step(r3, o3);
+                }
+            }
+        }
+        return decodeRun(r0, o0, e0) && r0.consumedBits() <= streams[0].size() * 8 &&
+               decodeRun(r1, o1, e1) && r1.consumedBits() <= streams[1].size() * 8 &&
+               decodeRun(r2, o2, e2) && r2.consumedBits() <= streams[2].size() * 8 &&
+               decodeRun(r3, o3, e3) && r3.consumedBits() <= streams[3].size() * 8;
+    }
+
+    bool decodeRun(HuffmanBitReader& r, uint8_t* out, uint8_t* end) const {
+        const HuffmanDecodeEntry* root = entries.data();
+        HuffmanDecodeEntry e;
+        // Four probes use at most 48 of the 56 bits a refill guarantees.
+        while (end - out >= 8) {
+            r.refill();
+            for (int i = 0; i < 4; ++i) {
+                e = root[r.buffer >> (64 - kRootBits)];
+                if (e.count == 0) return false;
+                out[0] = e.symbol[0];
+                out[1] = e.symbol[1];
+                out += e.count;
+                r.consume(e.length);
+            }
+        }
+        while (out < end) {
+            r.refill();
+            e = root[r.buffer >> (64 - kRootBits)];
+            if (e.count == 0) return false;
+            *out++ = e.symbol[0];
+            r.consume(e.firstLength);
+        }
+        return true;
+    }
+
+    // A root entry whose code leaves room for a whole second code in the same probe decodes both.
+    void pairRootEntries() {
+        std::vector<HuffmanDecodeEntry> single(entries.begin(), entries.begin() + (size_t(1) << kRootBits));
+        size_t mask = (size_t(1) << kRootBits) - 1;
+        for (size_t i = 0; i < single.size(); ++i) {
+            HuffmanDecodeEntry& e = entries[i];
+            if (e.count != 1) continue;
+            const HuffmanDecodeEntry& next = single[(i << e.length) & mask];
+            if (next.count != 1 || e.length + next.length > kRootBits) continue;
+            e.symbol[1] = next.symbol[0];
+            e.count = 2;
+            e.length += next.length;
+        }
+    }
+};
+
+// Compressed layout: symbol count (8 bytes, little-endian), stream count, the 256 code lengths packed two per byte,
+// the byte sizes of all streams but the last (4 bytes each), then the canonical bitstreams. Stream j holds the
+// j-th of `streams` equal slices of the input.
+constexpr size_t kHuffmanHeaderBytes = 8 + 1 + 128;
+constexpr int kDefaultHuffmanStreams = 4;
+
+bool validHuffmanStreamCount(int streams) {
+    return streams == 1 || streams == 4 || streams == 8;
+}
+
+void putLittleEndian(uint8_t* out, uint64_t value, int bytes = 8) {
+    for (int i = 0; i < bytes; ++i) out[i] = (uint8_t)(value >> (8 * i));
+}
+
+uint64_t getLittleEndian(const uint8_t* in, int bytes = 8) {
+    uint64_t value = 0;
+    for (int i = bytes - 1; i >= 0; --i) value = (value << 8) | in[i];
+    return value;
+}
+
+void writeHuffmanHeader(size_t symbolCount, int streams, const CodeLengths& lengths, uint8_t* out) {
+    putLittleEndian(out, symbolCount);
+    out[8] = (uint8_t)streams;
+    for (int i = 0; i < 128; ++i) out[9 + i] = (uint8_t)(lengths[2 * i] << 4 | lengths[2 * i + 1]);
+}
+
+bool readHuffmanHeader(std::span<const uint8_t> data, size_t& symbolCount, int& streams, CodeLengths& lengths) {
+    if (data.size() < kHuffmanHeaderBytes) return false;
+    symbolCount = (size_t)getLittleEndian(data.data());
+    streams = data[8];
+    if (!validHuffmanStreamCount(streams)) return false;
+    uint64_t kraft = 0;
+    for (int i = 0; i < 256; ++i) {
+        lengths[i] = (i & 1) ? data[9 + i / 2] & 15 : data[9 + i / 2] >> 4;
+        if (lengths[i] > kMaxHuffmanCodeLength) return false;
+        if (lengths[i]) kraft += uint64_t(1) << (kMaxHuffmanCodeLength - lengths[i]);
+    }
+    return kraft <= (uint64_t(1) << kMaxHuffmanCodeLength) && (kraft > 0 || symbolCount == 0);
+}
+
+// freq must be text's histogram; it sizes a single-stream output without another pass over the text.
+std::vector<uint8_t> compressHuffman(std::string_view text, const HuffmanFrequencies& freq, const CodeLengths& lengths,
+                                     int streams = kDefaultHuffmanStreams) {
+    HuffmanCodeTable table = canonicalCodes(lengths);
+    size_t slice = (text.size() + streams - 1) / streams;
+    std::vector<std::string_view> slices;
+    std::vector<uint64_t> streamBytes;
+    for (int j = 0; j < streams; ++j) {
+        size_t begin = std::min(text.size(), j * slice);
+        slices.push_back(text.substr(begin, std::min(slice, text.size() - begin)));
+        uint64_t bits = 0;
+        if (streams == 1) {
+            for (int s = 0; s < 256; ++s) bits += freq[s] * lengths[s];
+        } else {
+            for (unsigned char c : slices[j]) bits += table[c].length;
+        }
+        streamBytes.push_back((bits + 7) / 8);
+    }
+
+    size_t headerBytes = kHuffmanHeaderBytes + 4 * (streams - 1);
+    size_t total = headerBytes;
+    for (uint64_t bytes : streamBytes) total += bytes;
+    std::vector<uint8_t> out(total);
+    writeHuffmanHeader(text.size(), streams, lengths, out.data());
+    uint8_t* at = out.data() + headerBytes;
+    for (int j = 0; j < streams; ++j) {
+        if (j + 1 < streams) putLittleEndian(out.data() + kHuffmanHeaderBytes + 4 * j, streamBytes[j], 4);
+        encodeHuffmanInto(slices[j], table, at);
+        at += streamBytes[j];
+    }
+    return out;
+}
+
+// Decodes a payload that must hold exactly out.size() symbols.
+bool decompressHuffmanInto(std::span<const uint8_t> data, std::span<uint8_t> out) {
+    GV_TIME(Decode);
+    GV_COUNT(BytesDecoded, out.size());
+    size_t symbolCount;
+    int streams;
+    CodeLengths lengths;
+    if (!readHuffmanHeader(data, symbolCount, streams, lengths) || symbolCount != out.size()) return false;
+    size_t headerBytes = kHuffmanHeaderBytes + 4 * (streams - 1);
+    if (data.size() < headerBytes) return false;
+
+    std::array<std::span<const uint8_t>, 8> parts;
+    size_t at = headerBytes;
+    for (int j = 0; j < streams; ++j) {
+        size_t bytes = j + 1 < streams ? (size_t)getLittleEndian(&data[kHuffmanHeaderBytes + 4 * j], 4) : data.size() - at;
+        if (bytes > data.size() - at) return false;
+        parts[j] = data.subspan(at, bytes);
+        at += bytes;
+    }
+    if (symbolCount > (data.size() - headerBytes) * 8) return false;
+
+    size_t slice = (symbolCount + streams - 1) / streams;
+    std::array<size_t, 9> bounds;
+    for (int j = 0; j <= streams; ++j) bounds[j] = std::min(symbolCount, j * slice);
+    HuffmanDecoder decoder(canonicalCodes(lengths));
+    return decoder.decodeStreams(parts.data(), streams, out.data(), bounds.data());
+}
+
+bool decompressHuffman(std::span<const uint8_t> data, std::string& text) {
+    if (data.size() < kHuffmanHeaderBytes) return false;
+    size_t symbolCount = (size_t)getLittleEndian(data.data());
+    if (symbolCount > (data.size() - kHuffmanHeaderBytes) * 8) return false;
+    text.assign(symbolCount, '\0');
+    return decompressHuffmanInto(data, {(uint8_t*)text.data(), symbolCount});
+}
+
+struct HuffmanRun {
+    int uniqueSymbols = 0, maxCodeLength = 0;
+    size_t compressedBytes = 0;
+    double buildMs = 0, encodeMs = 0, decodeMs = 0;
+    bool roundTripOk = false;
+};
+
+HuffmanRun runHuffmanPipeline(const std::string& text, int streams = kDefaultHuffmanStreams) {
+    HuffmanRun run;
+    auto t0 = std::chrono::steady_clock::now();
+    HuffmanFrequencies freq = countSymbols(text);
+    CodeLengths lengths = limitedCodeLengths(freq);
+    run.buildMs = elapsedMs(t0);
+    for (uint8_t length : lengths) {
+        run.uniqueSymbols += length > 0;
+        run.maxCodeLength = std::max<int>(run.maxCodeLength, length);
+    }
+
+    t0 = std::chrono::steady_clock::now();
+    std::vector<uint8_t> compressed = compressHuffman(text, freq, lengths, streams);
+    run.encodeMs = elapsedMs(t0);
+    run.compressedBytes = compressed.size();
+
+    t0 = std::chrono::steady_clock::now();
+    std::string decoded;
+    bool decodedOk = decompressHuffman(compressed, decoded);
+    run.decodeMs = elapsedMs(t0);
+    run.roundTripOk = decodedOk && decoded == text;
+    return run;
+}
+
+void drawLine(sf::RenderTarget& window, sf::Vector2f p1, sf::Vector2f p2) {
+    sf::Vertex line[] = { sf::Vertex{p1, sf::Color::White}, sf::Vertex{p2, sf::Color::White} };
+    window.draw(line, 2, sf::PrimitiveType::Lines);
+}
+
+void layoutTree(const HuffmanTree& tree, int index, float x, float y, float hSpacing, std::vector<sf::Vector2f>& at) {
+    if (index < 0) return;
+    const HuffmanTreeNode& node = tree.nodes[index];
+    at[index] = {x, y};
+    float vSpacing = 80.f;
+    layoutTree(tree, node.left, x - hSpacing, y + vSpacing, hSpacing / 2.f, at);
+    layoutTree(tree, node.right, x + hSpacing, y + vSpacing, hSpacing / 2.f, at);
+}
+
+void drawTreeNodes(sf::RenderTarget& window, const HuffmanTree& tree, const std::vector<sf::Vector2f>& at) {
+    for (int i = 0; i < tree.size; ++i) {
+        const HuffmanTreeNode& node = tree.nodes[i];
+        for (int child : {node.left, node.right}) {
+            if (child >= 0) drawLine(window, at[i] + sf::Vector2f(0.f, 20.f), at[child] - sf::Vector2f(0.f, 20.f));
+        }
+    }
+    for (int i = 0; i < tree.size; ++i) {
+        sf::CircleShape circle(20.f);
+        circle.setOrigin({20.f, 20.f});
+        circle.setPosition(at[i]);
+        circle.setFillColor(sf::Color::Cyan);
+        circle.setOutlineColor(sf::Color::White);
+        circle.setOutlineThickness(2.f);
+        window.draw(circle);
+    }
+}
+
+std::string treeNodeLabel(const HuffmanTreeNode& node) {
+    if (node.symbol < 0) return std::to_string(node.freq);
+    if (node.symbol == ' ') return "' '";
+    if (node.symbol == '\n') return "\\n";
+    return std::string(1, (char)node.symbol);
+}
+
+std::string codeTableString(const std::map<char, std::string>& codes) {
+    std::stringstream ss;
+    ss << "Huffman Codes:\n";
+    for (auto pair : codes) {
+        if (pair.first == ' ') ss << "' '";
+        else if (pair.first == '\n') ss << "\\n";
+        else ss << " " << pair.first;
+        ss << " : " << pair.second << "\n";
+    }
+    return ss.str();
+}
+
+// The tree never changes while it is shown, so layout and labels are built once. It is laid
+// out for a 1200x800 view.
+class HuffmanScene {
+public:
+    HuffmanScene(const HuffmanTree& tree, const std::map<char, std::string>& codes, const sf::Font& font)
+        : tree(tree), at(tree.size), labels(font), tableText(font) {
+        layoutTree(tree, 0, 600.f, 100.f, 300.f, at);
+        for (int i = 0; i < tree.size; ++i) {
+            labels.add(at[i], 18, sf::Color::Black, treeNodeLabel(tree.nodes[i]));
+        }
+        tableText.setString(codeTableString(codes));
+        tableText.setCharacterSize(18);
+        tableText.setFillColor(sf::Color::White);
+        tableText.setPosition({30.f, 30.f});
+    }
+
+    void draw(sf::RenderTarget& target) {
+        target.clear(sf::Color(30,30,40));
+        drawTreeNodes(target, tree, at);
+        labels.draw(target);
+        target.draw(tableText);
+    }
+
+private:
+    const HuffmanTree& tree;
+    std::vector<sf::Vector2f> at;
+    LabelBatch labels;
+    sf::Text tableText;
+};
+
+void visualizeHuffman(const HuffmanTree& tree, std::map<char, std::string>& codes) {
+    sf::RenderWindow window(sf::VideoMode(sf::Vector2u{1200u, 800u}), "Huffman Tree Visualization");
+
+    sf::Font font;
+    if (!loadFont(font)) return;
+    HuffmanScene scene(tree, codes, font);
+
+    while (window.isOpen()) {
+        for (auto ev = window.pollEvent(); ev.has_value(); ev = window.pollEvent()) {
+            if (ev->is<sf::Event::Closed>()) window.close();
+        }
+
+        scene.draw(window);
+        window.display();
+    }
+}
+
+// The Huffman view is a single still, so its export is one frame of the code tree for `text`.
+bool exportHuffmanTree(const std::string& text, const FrameExportOptions& options) {
+    sf::Font font;
+    if (!loadFont(font)) return false;
+    sf::RenderTexture target;
+    if (!target.resize(options.size)) {
+        std::cerr << "Error: Could not create a " << options.size.x << "x" << options.size.y << " render texture.\n";
+        return false;
+    }
+    FrameEncoder encoder;
+    if (!encoder.open(options.target)) return false;
+
+    HuffmanFrequencies freq = countSymbols(text);
+    HuffmanCodeTable table = canonicalCodes(limitedCodeLengths(freq));
+    std::map<char, std::string> codes = codeStrings(table);
+    HuffmanTree tree = codeTree(table, freq);
+    HuffmanScene scene(tree, codes, font);
+
+    target.setView(sf::View(sf::FloatRect({0.f, 0.f}, {1200.f, 800.f})));
+    scene.draw(target);
+    target.display();
+    encoder.push(target.getTexture().copyToImage());
+    bool ok = encoder.finish();
+    std::ostream& report = options.target == "-" ? std::cerr : std::cout;
+    report << "frames: " << encoder.framesWritten() << "\n";
+    return ok;
+}
+
+void runHuffman() {
+    std::cout << "Enter a string to encode: ";
+    std::string text;
+    std::getline(std::cin >> std::ws, text);
+
+    HuffmanFrequencies freq = countSymbols(text);
+    HuffmanCodeTable table = canonicalCodes(limitedCodeLengths(freq));
+    std::map<char, std::string> codes = codeStrings(table);
+    HuffmanTree tree = codeTree(table, freq);
+
+    std::cout << "\nHuffman Codes:\n";
+    PackedBits encoded = encodeHuffman(text, table);
+    for (char c : text) {
+        std::string codeStr = codes[c];
+
+        if (c == ' ') std::cout << "' '";
+        else if (c == '\n') std::cout << "\\n";
+        else std::cout << " " << c;
+        std::cout << " : " << codeStr << "\n";
+    }
+
+    std::cout << "\nOriginal string (" << text.length() << " chars): " << text << "\n";
+    std::cout << "Encoded string (" << encoded.bitCount << " bits, " << encoded.bytes.size() << " bytes): "
+              << bitString(encoded) << "\n";
+
+    std::string decodedString(encoded.symbolCount, '\0');
+    if (!HuffmanDecoder(table).decode(encoded.bytes, (uint8_t*)decodedString.data(), decodedString.size())) {
+        std::cerr << "Error: the encoded string failed to decode.\n";
+        return;
+    }
+    std::cout << "Decoded string: " << decodedString << "\n";
+
+    visualizeHuffman(tree, codes);
+}
+
+
+long long peakRssKb() {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) return 0;
+    return (long long)(pmc.PeakWorkingSetSize / 1024);
+#else
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+#endif
+}
+
+bool readFileBytes(const std::string& path, std::string& out) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        std::cerr << "Error: Could not open '" << path << "'.\n";
+        return false;
+    }
+    out.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return true;
+}
+
+class MappedFile {
+public:
+    static std::shared_ptr<MappedFile> open(const std::string& path) {
+        auto file = std::shared_ptr<MappedFile>(new MappedFile());
+#if defined(_WIN32)
+        file->handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                   FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file->handle == INVALID_HANDLE_VALUE) return fail(path);
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file->handle, &size)) return fail(path);
+        file->length = (size_t)size.QuadPart;
+        if (file->length == 0) return file;
+        file->mapping = CreateFileMappingA(file->handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!file->mapping) return fail(path);
+        file->base = (const char*)MapViewOfFile(file->mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!file->base) return fail(path);
+#else
+        file->fd = ::open(path.c_str(), O_RDONLY);
+        if (file->fd < 0) return fail(path);
+        struct stat st;
+        if (fstat(file->fd, &st) != 0) return fail(path);
+        file->length = (size_t)st.st_size;
+        if (file->length == 0) return file;
+        void* p = mmap(nullptr, file->length, PROT_READ, MAP_PRIVATE, file->fd, 0);
+        if (p == MAP_FAILED) return fail(path);
+        file->base = (const char*)p;
+#endif
+        return file;
+    }
+
+    ~MappedFile() {
+#if defined(_WIN32)
+        if (base) UnmapViewOfFile(base);
+        if (mapping) CloseHandle(mapping);
+        if (handle != INVALID_HANDLE_VALUE) CloseHandle(handle);
+#else
+        if (base) munmap((void*)base, length);
+        if (fd >= 0) ::close(fd);
+#endif
+    }
+
+    const char* data() const { return base; }
+    size_t size() const { return length; }
+
+private:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    static std::shared_ptr<MappedFile> fail(const std::string& path) {
+        std::cerr << "Error: Could not map '" << path << "'.\n";
+        return nullptr;
+    }
+
+    const char* base = nullptr;
+    size_t length = 0;
+#if defined(_WIN32)
+    HANDLE handle = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+};
+
+enum class GraphFormat { Auto, Matrix, EdgeList, Dimacs, MatrixMarket, Snapshot };
+
+const char kSnapshotMagic[8] = {'G', 'V', 'C', 'S', 'R', '0', '0', '1'};
+
+// Native binary snapshot: this header, then int64 offsets[n + 1], int32 targets[m] and int32 weights[m]
+// in host byte order. Loading maps the file and points the graph straight at those arrays.
+struct SnapshotHeader {
+    char magic[8];
+    unsigned long long n;
+    unsigned long long m;
+    unsigned long long offsetsAt;
+    unsigned long long targetsAt;
+    unsigned long long weightsAt;
+};
+
+bool parseGraphFormat(const std::string& name, GraphFormat& format) {
+    if (name == "auto") format = GraphFormat::Auto;
+    else if (name == "matrix") format = GraphFormat::Matrix;
+    else if (name == "edges") format = GraphFormat::EdgeList;
+    else if (name == "dimacs") format = GraphFormat::Dimacs;
+    else if (name == "mtx") format = GraphFormat::MatrixMarket;
+    else if (name == "snapshot") format = GraphFormat::Snapshot;
+    else return false;
+    return true;
+}
+
+const char* skipBlanks(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) ++p;
+    return p;
+}
+
+const char* nextLine(const char* p, const char* end) {
+    const char* nl = (const char*)std::memchr(p, '\n', end - p);
+    return nl ? nl + 1 : end;
+}
+
+template <typename T>
+bool parseToken(const char*& p, const char* end, T& out) {
+    p = skipBlanks(p, end);
+    auto [next, ec] = std::from_chars(p, end, out);
+    if (ec != std::errc()) return false;
+    p = next;
+    return true;
+}
+
+GraphFormat detectGraphFormat(const MappedFile& file) {
+    const char* p = file.data();
+    const char* end = p + file.size();
+    if (file.size() >= sizeof(kSnapshotMagic) && std::memcmp(p, kSnapshotMagic, sizeof(kSnapshotMagic)) == 0) {
+        return GraphFormat::Snapshot;
+    }
+    if (file.size() >= 14 && std::memcmp(p, "%%MatrixMarket", 14) == 0) return GraphFormat::MatrixMarket;
+    for (; p < end; p = nextLine(p, end)) {
+        const char* q = skipBlanks(p, end);
+        if (q == end || *q == '\n' || *q == '#' || *q == '%') continue;
+        if (*q == 'c' || *q == 'p' || *q == 'a') return GraphFormat::Dimacs;
+        long long first;
+        if (!parseToken(q, end, first)) break;
+        q = skipBlanks(q, end);
+        return (q == end || *q == '\n') ? GraphFormat::Matrix : GraphFormat::EdgeList;
+    }
+    return GraphFormat::EdgeList;
+}
+
+struct EdgeLineSyntax {
+    GraphFormat format;
+    int base;
+    bool realWeights;
+    bool patternWeights;
+    bool mirror;
+    bool negateMirror;
+};
+
+// Splits [begin, end) at line boundaries and parses the pieces on the thread pool. Each piece keeps its
+// own edge buffer so csrFromEdgeChunks can scatter them without a merge step.
+bool parseEdgeLines(const char* begin, const char* end, const EdgeLineSyntax& syntax, int knownVertices,
+                    std::vector<std::vector<WeightedEdge>>& pieces, int& vertices, ThreadPool& pool) {
+    size_t pieceCount = std::max<size_t>(1, std::min<size_t>(pool.size() * 8, (end - begin) / (1 << 20) + 1));
+    std::vector<const char*> cuts{begin};
+    for (size_t i = 1; i < pieceCount; ++i) {
+        const char* cut = std::max(cuts.back(), begin + (end - begin) * i / pieceCount);
+        cuts.push_back(cut == begin ? begin : nextLine(cut - 1, end));
+    }
+    cuts.push_back(end);
+
+    pieces.assign(pieceCount, {});
+    std::vector<long long> maxId(pieceCount, -1);
+    std::vector<const char*> badLine(pieceCount, nullptr);
+
+    pool.parallelFor(0, (long long)pieceCount, 1, [&](long long lo, long long hi, unsigned) {
+        for (long long c = lo; c < hi; ++c) {
+            std::vector<WeightedEdge>& out = pieces[c];
+            for (const char* p = cuts[c]; p < cuts[c + 1]; p = nextLine(p, end)) {
+                const char* q = skipBlanks(p, end);
+                if (q == end || *q == '\n' || *q == '#' || *q == '%') continue;
+                if (syntax.format == GraphFormat::Dimacs) {
+                    if (*q != 'a') continue;
+                    ++q;
+                }
+                long long u, v, w = 1;
+                if (!parseToken(q, end, u) || !parseToken(q, end, v)) {
+                    badLine[c] = p;
+                    break;
+                }
+                if (syntax.realWeights) {
+                    double x;
+                    // llround is undefined past long long (and for NaN); the int range is checked below.
+                    if (!parseToken(q, end, x) || !(std::fabs(x) < 9e18)) {
+                        badLine[c] = p;
+                        break;
+                    }
+                    w = std::llround(x);
+                } else if (!syntax.patternWeights) {
+                    const char* before = q;
+                    if (!parseToken(q, end, w)) {
+                        if (syntax.format != GraphFormat::EdgeList) {
+                            badLine[c] = p;
+                            break;
+                        }
+                        q = before;
+                        w = 1;
+                    }
+                }
+                u -= syntax.base;
+                v -= syntax.base;
+                bool inRange = u >= 0 && v >= 0 && u < INT_MAX && v < INT_MAX &&
+                               (knownVertices < 0 || (u < knownVertices && v < knownVertices));
+                // A skew-symmetric mirror stores -w, which must fit as well.
+                bool weightInRange = w >= INT_MIN && w <= INT_MAX && (!syntax.negateMirror || -w <= INT_MAX);
+                if (!inRange || !weightInRange) {
+                    badLine[c] = p;
+                    break;
+                }
+                maxId[c] = std::max({maxId[c], u, v});
+                out.push_back({(int)u, (int)v, (int)w});
+                if (syntax.mirror && u != v) out.push_back({(int)v, (int)u, syntax.negateMirror ? (int)-w : (int)w});
+            }
+        }
+    });
+
+    for (const char* bad : badLine) {
+        if (bad) {
+            std::cerr << "Error: malformed or out-of-range edge at byte " << (bad - begin) << ": "
+                      << std::string(bad, nextLine(bad, end) - bad);
+            return false;
+        }
+    }
+    long long highest = *std::max_element(maxId.begin(), maxId.end());
+    vertices = knownVertices >= 0 ? knownVertices : (int)(highest + 1);
+    return true;
+}
+
+CsrGraph csrFromPieces(int n, const std::vector<std::vector<WeightedEdge>>& pieces, ThreadPool& pool) {
+    std::vector<std::span<const WeightedEdge>> chunks(pieces.begin(), pieces.end());
+    return csrFromEdgeChunks(n, chunks, pool);
+}
+
+bool loadSnapshot(const std::shared_ptr<MappedFile>& file, const std::string& path, CsrGraph& graph) {
+    SnapshotHeader h;
+    if (file->size() < sizeof(h)) {
+        std::cerr << "Error: '" << path << "' is too small to be a graph snapshot.\n";
+        return false;
+    }
+    std::memcpy(&h, file->data(), sizeof(h));
+    // Divide rather than multiply so a hostile count or offset cannot wrap around.
+    unsigned long long size = file->size();
+    auto fits = [&](unsigned long long at, unsigned long long count, unsigned long long width) {
+        return at <= size && count <= (size - at) / width;
+    };
+    bool sane = std::memcmp(h.magic, kSnapshotMagic, sizeof(kSnapshotMagic)) == 0 && h.n < (unsigned long long)INT_MAX &&
+                h.offsetsAt % alignof(long long) == 0 && h.targetsAt % alignof(int) == 0 &&
+                h.weightsAt % alignof(int) == 0 && fits(h.offsetsAt, h.n + 1, sizeof(long long)) &&
+                fits(h.targetsAt, h.m, sizeof(int)) && fits(h.weightsAt, h.m, sizeof(int));
+    if (!sane) {
+        std::cerr << "Error: '" << path << "' has a corrupt snapshot header.\n";
+        return false;
+    }
+    graph.n = (int)h.n;
+    graph.offsets = std::span<const long long>((const long long*)(file->data() + h.offsetsAt), h.n + 1);
+    graph.targets = std::span<const int>((const int*)(file->data() + h.targetsAt), h.m);
+    graph.weights = std::span<const int>((const int*)(file->data() + h.weightsAt), h.m);
+    graph.storage = file;
+    bool consistent = graph.offsets[0] == 0 && graph.offsets[graph.n] == (long long)h.m;
+    for (int v = 0; consistent && v < graph.n; ++v) consistent = graph.offsets[v] <= graph.offsets[v + 1];
+    if (!consistent) {
+        std::cerr << "Error: '" << path << "' has inconsistent snapshot offsets.\n";
+        return false;
+    }
+    for (int t : graph.targets) {
+        if (t < 0 || t >= graph.n) {
+            std::cerr << "Error: '" << path << "' has a snapshot edge to a vertex outside the graph.\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool writeSnapshot(const std::string& path, const CsrGraph& graph) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        std::cerr << "Error: Could not create '" << path << "'.\n";
+        return false;
+    }
+    SnapshotHeader h{};
+    std::memcpy(h.magic, kSnapshotMagic, sizeof(kSnapshotMagic));
+    h.n = graph.n;
+    h.m = graph.edgeCount();
+    h.offsetsAt = sizeof(h);
+    h.targetsAt = h.offsetsAt + (h.n + 1) * sizeof(long long);
+    h.weightsAt = h.targetsAt + h.m * sizeof(int);
+    out.write((const char*)&h, sizeof(h));
+    out.write((const char*)graph.offsets.data(), graph.offsets.size_bytes());
+    out.write((const char*)graph.targets.data(), graph.targets.size_bytes());
+    out.write((const char*)graph.weights.data(), graph.weights.size_bytes());
+    if (!out) {
+        std::cerr << "Error: Could not write '" << path << "'.\n";
+        return false;
+    }
+    return true;
+}
+
+// Same layout the interactive prompt reads: n, then n*n weights with 0 meaning no edge.
+bool parseMatrixGraph(const MappedFile& file, const std::string& path, CsrGraph& graph) {
+    const char* p = file.data();
+    const char* end = p + file.size();
+    while (p < end && std::isspace((unsigned char)*p)) ++p;
+    int n;
+    if (!parseToken(p, end, n) || n <= 0) {
+        std::cerr << "Error: '" << path << "' is not an adjacency matrix file.\n";
+        return false;
+    }
+    std::vector<WeightedEdge> edges;
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) {
+            while (p < end && std::isspace((unsigned char)*p)) ++p;
+            int w;
+            if (!parseToken(p, end, w)) {
+                std::cerr << "Error: '" << path << "' ends before the " << n << "x" << n << " matrix does.\n";
+                return false;
+            }
+            if (w != 0) edges.push_back({i, j, w});
+        }
+    }
+    graph = csrFromEdges(n, edges);
+    return true;
+}
+
+bool loadGraph(const std::string& path, CsrGraph& graph, GraphFormat format = GraphFormat::Auto,
+               ThreadPool& pool = sharedThreadPool()) {
+    std::shared_ptr<MappedFile> file = MappedFile::open(path);
+    if (!file) return false;
+    if (file->size() == 0) {
+        std::cerr << "Error: '" << path << "' is empty.\n";
+        return false;
+    }
+    if (format == GraphFormat::Auto) format = detectGraphFormat(*file);
+    if (format == GraphFormat::Snapshot) return loadSnapshot(file, path, graph);
+    if (format == GraphFormat::Matrix) return parseMatrixGraph(*file, path, graph);
+
+    const char* begin = file->data();
+    const char* end = begin + file->size();
+    EdgeLineSyntax syntax{format, 0, false, false, false, false};
+    int knownVertices = -1;
+
+    if (format == GraphFormat::Dimacs) {
+        syntax.base = 1;
+        for (const char* p = begin; p < end; p = nextLine(p, end)) {
+            const char* q = skipBlanks(p, end);
+            if (q < end && *q == 'a') break;
+            if (q < end && *q == 'p') {
+                std::string line(q, nextLine(q, end));
+                std::stringstream ss(line);
+                std::string tag, problem;
+                long long n, m;
+                if (ss >> tag >> problem >> n >> m && n > 0 && n < INT_MAX) knownVertices = (int)n;
+                break;
+            }
+        }
+        if (knownVertices < 0) {
+            std::cerr << "Error: '" << path << "' has no valid DIMACS 'p sp n m' line.\n";
+            return false;
+        }
+    } else if (format == GraphFormat::MatrixMarket) {
+        syntax.base = 1;
+        const char* p = begin;
+        std::string banner(p, nextLine(p, end));
+        std::stringstream ss(banner);
+        std::string tag, object, layout, field, symmetry;
+        ss >> tag >> object >> layout >> field >> symmetry;
+        auto lower = [](std::string x) {
+            for (auto& c : x) c = (char)std::tolower((unsigned char)c);
+            return x;
+        };
+        layout = lower(layout);
+        field = lower(field);
+        symmetry = lower(symmetry);
+        if (layout != "coordinate" || field == "complex") {
+            std::cerr << "Error: only coordinate Matrix Market files with real, integer or pattern values are supported.\n";
+            return false;
+        }
+        syntax.realWeights = field == "real" || field == "double";
+        syntax.patternWeights = field == "pattern";
+        syntax.mirror = symmetry != "general";
+        syntax.negateMirror = symmetry == "skew-symmetric";
+        p = nextLine(p, end);
+        while (p < end && (skipBlanks(p, end) == end || *skipBlanks(p, end) == '%' || *skipBlanks(p, end) == '\n')) {
+            p = nextLine(p, end);
+        }
+        long long rows, cols, nnz;
+        if (!parseToken(p, end, rows) || !parseToken(p, end, cols) || !parseToken(p, end, nnz) ||
+            std::max(rows, cols) >= INT_MAX) {
+            std::cerr << "Error: '" << path << "' has no valid Matrix Market size line.\n";
+            return false;
+        }
+        knownVertices = (int)std::max(rows, cols);
+        begin = nextLine(p, end);
+    }
+
+    std::vector<std::vector<WeightedEdge>> pieces;
+    int n;
+    if (!parseEdgeLines(begin, end, syntax, knownVertices, pieces, n, pool)) return false;
+    graph = csrFromPieces(n, pieces, pool);
+    return true;
 }
 
-void drawLine(sf::RenderWindow& window, sf::Vector2f p1, sf::Vector2f p2) {
-    sf::Vertex line[] = { sf::Vertex{p1, sf::Color::White}, sf::Vertex{p2, sf::Color::White} };
-    window.draw(line, 2, sf::PrimitiveType::Lines);
+// Block container: "GVHUF001", the block size (8 bytes), one frame per block (payload length in 4 bytes, then a
+// compressHuffman payload), a zero length ending the frames, the index of frame offsets, and a trailer of index
+// offset, block count, total input bytes and "GVHUFEND". Integers are little-endian. Every block but the last holds
+// exactly blockSize input bytes. Streamed containers leave the index out and record index offset 0; readers then
+// walk the frame lengths instead.
+constexpr char kHuffmanContainerMagic[8] = {'G', 'V', 'H', 'U', 'F', '0', '0', '1'};
+constexpr char kHuffmanTrailerMagic[8] = {'G', 'V', 'H', 'U', 'F', 'E', 'N', 'D'};
+constexpr size_t kHuffmanContainerHeaderBytes = 16;
+constexpr size_t kHuffmanTrailerBytes = 32;
+constexpr size_t kDefaultHuffmanBlockSize = 1 << 20;
+constexpr size_t kMaxHuffmanBlockSize = 1 << 30;
+
+struct HuffmanContainer {
+    std::shared_ptr<MappedFile> file;
+    uint64_t blockSize = 0, totalBytes = 0;
+    std::vector<uint64_t> frameOffsets;
+
+    uint64_t blockBytes(size_t block) const {
+        return std::min(blockSize, totalBytes - block * blockSize);
+    }
+};
+
+struct HuffmanFileStats {
+    uint64_t inputBytes = 0, outputBytes = 0, blocks = 0;
+};
+
+// The end-of-frames marker, the index when there is one, and the trailer.
+std::vector<uint8_t> containerTail(const std::vector<uint64_t>& index, uint64_t indexAt, uint64_t blockCount,
+                                   uint64_t totalBytes) {
+    std::vector<uint8_t> tail(4 + index.size() * 8 + kHuffmanTrailerBytes, 0);
+    for (size_t b = 0; b < index.size(); ++b) putLittleEndian(&tail[4 + b * 8], index[b]);
+    uint8_t* trailer = tail.data() + 4 + index.size() * 8;
+    putLittleEndian(trailer, indexAt);
+    putLittleEndian(trailer + 8, blockCount);
+    putLittleEndian(trailer + 16, totalBytes);
+    std::memcpy(trailer + 24, kHuffmanTrailerMagic, 8);
+    return tail;
 }
 
-void drawTreeNodes(sf::RenderWindow& window, const sf::Font& font, HuffmanNode* node, float x, float y, float hSpacing) {
-    if (node == nullptr) return;
-
-    sf::CircleShape circle(20.f);
-    circle.setOrigin({20.f, 20.f});
-    circle.setPosition({x, y});
-    circle.setFillColor(sf::Color::Cyan);
-    circle.setOutlineColor(sf::Color::White);
-    circle.setOutlineThickness(2.f);
-    window.draw(circle);
-
-    sf::Text text(font);
-    std::string label;
-    if (node->data == '$') {
-        label = std::to_string(node->freq);
-    } else if (node->data == ' ') {
-        label = "' '";
-    } else if (node->data == '\n') {
-        label = "\\n";
-    } else {
-        label = std::string(1, node->data);
+bool writeAll(std::ofstream& out, const uint8_t* data, size_t size, uint64_t& written) {
+    out.write((const char*)data, (std::streamsize)size);
+    written += size;
+    return (bool)out;
+}
+
+// Blocks are modelled and encoded in parallel a batch at a time and written in order, so memory stays at a few
+// blocks per worker whatever the input size.
+bool compressHuffmanFile(const std::string& inPath, const std::string& outPath, size_t blockSize, int streams,
+                         HuffmanFileStats& stats, ThreadPool& pool = sharedThreadPool()) {
+    auto file = MappedFile::open(inPath);
+    if (!file) return false;
+    std::ofstream out(outPath, std::ios::binary);
+    if (!out) {
+        std::cerr << "Error: Could not create '" << outPath << "'.\n";
+        return false;
     }
-    text.setString(label);
-    text.setCharacterSize(18);
-    text.setFillColor(sf::Color::Black);
-    sf::FloatRect textRect = text.getLocalBounds();
-    text.setOrigin({textRect.position.x + textRect.size.x / 2.0f,
-                   textRect.position.y + textRect.size.y / 2.0f});
-    text.setPosition({x, y});
-    window.draw(text);
 
-    float vSpacing = 80.f;
-    if (node->left) {
-        sf::Vector2f leftPos(x - hSpacing, y + vSpacing);
-        drawLine(window, {x, y + 20.f}, {leftPos.x, leftPos.y - 20.f});
-        drawTreeNodes(window, font, node->left, leftPos.x, leftPos.y, hSpacing / 2.f);
+    uint8_t header[kHuffmanContainerHeaderBytes];
+    std::memcpy(header, kHuffmanContainerMagic, 8);
+    putLittleEndian(header + 8, blockSize);
+    uint64_t written = 0;
+    bool ok = writeAll(out, header, sizeof(header), written);
+
+    size_t blockCount = (file->size() + blockSize - 1) / blockSize;
+    size_t batch = pool.size() * 4;
+    std::vector<std::vector<uint8_t>> frames(batch);
+    std::vector<uint64_t> index;
+    for (size_t first = 0; ok && first < blockCount; first += batch) {
+        size_t last = std::min(blockCount, first + batch);
+        pool.parallelFor((long long)first, (long long)last, 1, [&](long long lo, long long hi, unsigned) {
+            for (long long b = lo; b < hi; ++b) {
+                size_t begin = (size_t)b * blockSize;
+                std::string_view block(file->data() + begin, std::min(blockSize, file->size() - begin));
+                HuffmanFrequencies freq = countSymbols(block);
+                frames[b - first] = compressHuffman(block, freq, limitedCodeLengths(freq), streams);
+            }
+        });
+        for (size_t b = first; ok && b < last; ++b) {
+            std::vector<uint8_t>& frame = frames[b - first];
+            uint8_t length[4];
+            putLittleEndian(length, frame.size(), 4);
+            index.push_back(written);
+            ok = writeAll(out, length, 4, written) && writeAll(out, frame.data(), frame.size(), written);
+            std::vector<uint8_t>().swap(frame);
+        }
     }
-    if (node->right) {
-        sf::Vector2f rightPos(x + hSpacing, y + vSpacing);
-        drawLine(window, {x, y + 20.f}, {rightPos.x, rightPos.y - 20.f});
-        drawTreeNodes(window, font, node->right, rightPos.x, rightPos.y, hSpacing / 2.f);
+
+    std::vector<uint8_t> tail = containerTail(index, written + 4, blockCount, file->size());
+    ok = ok && writeAll(out, tail.data(), tail.size(), written);
+    if (!ok) {
+        std::cerr << "Error: Could not write '" << outPath << "'.\n";
+        return false;
     }
+    stats = {file->size(), written, blockCount};
+    return true;
 }
 
-void drawCodeTable(sf::RenderWindow& window, const sf::Font& font, std::map<char, std::string>& codes) {
-    std::stringstream ss;
-    ss << "Huffman Codes:\n";
-    for (auto pair : codes) {
-        if (pair.first == ' ') ss << "' '";
-        else if (pair.first == '\n') ss << "\\n";
-        else ss << " " << pair.first;
-        ss << " : " << pair.second << "\n";
+bool openHuffmanContainer(const std::string& path, HuffmanContainer& container) {
+    container.file = MappedFile::open(path);
+    if (!container.file) return false;
+    const uint8_t* data = (const uint8_t*)container.file->data();
+    size_t size = container.file->size();
+    auto corrupt = [&] {
+        std::cerr << "Error: '" << path << "' is not a valid Huffman container.\n";
+        return false;
+    };
+    if (size < kHuffmanContainerHeaderBytes + kHuffmanTrailerBytes) return corrupt();
+    if (std::memcmp(data, kHuffmanContainerMagic, 8) != 0) return corrupt();
+    const uint8_t* trailer = data + size - kHuffmanTrailerBytes;
+    if (std::memcmp(trailer + 24, kHuffmanTrailerMagic, 8) != 0) return corrupt();
+
+    container.blockSize = getLittleEndian(data + 8);
+    uint64_t indexAt = getLittleEndian(trailer);
+    uint64_t blockCount = getLittleEndian(trailer + 8);
+    container.totalBytes = getLittleEndian(trailer + 16);
+    if (container.blockSize == 0 || container.blockSize > kMaxHuffmanBlockSize) return corrupt();
+    if (blockCount != (container.totalBytes + container.blockSize - 1) / container.blockSize) return corrupt();
+
+    uint64_t tailAt = size - kHuffmanTrailerBytes;
+    if (indexAt == 0) {
+        for (uint64_t at = kHuffmanContainerHeaderBytes;;) {
+            if (at + 4 > tailAt) return corrupt();
+            uint64_t length = getLittleEndian(data + at, 4);
+            if (length == 0) {
+                if (at + 4 != tailAt) return corrupt();
+                break;
+            }
+            if (at + 4 + length > tailAt || container.frameOffsets.size() == blockCount) return corrupt();
+            container.frameOffsets.push_back(at);
+            at += 4 + length;
+        }
+        return container.frameOffsets.size() == blockCount || corrupt();
+    }
+
+    if (indexAt < kHuffmanContainerHeaderBytes + 4 || indexAt > tailAt) return corrupt();
+    if (blockCount != (tailAt - indexAt) / 8 || getLittleEndian(data + indexAt - 4, 4) != 0) return corrupt();
+    uint64_t framesEnd = indexAt - 4;
+    container.frameOffsets.resize(blockCount);
+    for (size_t b = 0; b < blockCount; ++b) {
+        uint64_t at = getLittleEndian(data + indexAt + b * 8);
+        if (at < kHuffmanContainerHeaderBytes || at + 4 > framesEnd) return corrupt();
+        if (at + 4 + getLittleEndian(data + at, 4) > framesEnd) return corrupt();
+        container.frameOffsets[b] = at;
     }
+    return true;
+}
 
-    sf::Text tableText(font);
-    tableText.setString(ss.str());
-    tableText.setCharacterSize(18);
-    tableText.setFillColor(sf::Color::White);
-    tableText.setPosition({30.f, 30.f});
-    window.draw(tableText);
+// Random access: decodes one block into out, which must hold container.blockBytes(block) bytes.
+bool decodeContainerBlock(const HuffmanContainer& container, size_t block, uint8_t* out) {
+    const uint8_t* frame = (const uint8_t*)container.file->data() + container.frameOffsets[block];
+    size_t length = (size_t)getLittleEndian(frame, 4);
+    return decompressHuffmanInto({frame + 4, length}, {out, (size_t)container.blockBytes(block)});
 }
 
-void visualizeHuffman(HuffmanNode* root, std::map<char, std::string>& codes) {
-    sf::RenderWindow window(sf::VideoMode(sf::Vector2u{1200u, 800u}), "Huffman Tree Visualization");
+// Decodes every block, or just onlyBlock when it is not negative, with the same batching as the compressor.
+bool decompressHuffmanFile(const std::string& inPath, const std::string& outPath, long long onlyBlock,
+                           HuffmanFileStats& stats, ThreadPool& pool = sharedThreadPool()) {
+    HuffmanContainer container;
+    if (!openHuffmanContainer(inPath, container)) return false;
+    size_t first = 0, blockCount = container.frameOffsets.size();
+    if (onlyBlock >= 0) {
+        if ((size_t)onlyBlock >= blockCount) {
+            std::cerr << "Error: block " << onlyBlock << " is out of range (" << blockCount << " blocks).\n";
+            return false;
+        }
+        first = (size_t)onlyBlock;
+        blockCount = first + 1;
+    }
+    std::ofstream out(outPath, std::ios::binary);
+    if (!out) {
+        std::cerr << "Error: Could not create '" << outPath << "'.\n";
+        return false;
+    }
 
-    sf::Font font;
-    if (!font.openFromFile("C:/Windows/Fonts/arial.ttf")) {
-        std::cerr << "Error: Could not load font 'arial.ttf'.\n";
-        return;
+    size_t batch = pool.size() * 4;
+    std::vector<uint8_t> buffer(std::min<uint64_t>(batch, blockCount - first) * container.blockSize);
+    std::atomic<bool> valid{true};
+    uint64_t written = 0;
+    for (size_t start = first; start < blockCount; start += batch) {
+        size_t last = std::min(blockCount, start + batch);
+        pool.parallelFor((long long)start, (long long)last, 1, [&](long long lo, long long hi, unsigned) {
+            for (long long b = lo; b < hi; ++b) {
+                if (!decodeContainerBlock(container, (size_t)b, &buffer[(b - start) * container.blockSize])) {
+                    valid.store(false, std::memory_order_relaxed);
+                }
+            }
+        });
+        if (!valid.load()) {
+            std::cerr << "Error: '" << inPath << "' has a corrupt block between " << start << " and " << last - 1 << ".\n";
+            return false;
+        }
+        uint64_t bytes = (last - 1 - start) * container.blockSize + container.blockBytes(last - 1);
+        if (!writeAll(out, buffer.data(), (size_t)bytes, written)) {
+            std::cerr << "Error: Could not write '" << outPath << "'.\n";
+            return false;
+        }
     }
+    stats = {container.file->size(), written, blockCount - first};
+    return true;
+}
 
-    while (window.isOpen()) {
-        for (auto ev = window.pollEvent(); ev.has_value(); ev = window.pollEvent()) {
-            if (ev->is<sf::Event::Closed>()) window.close();
+// Push/pull compressor with memory bounded by one block plus whatever output has not been pulled yet. It writes
+// the index-less container, so nothing grows with the input.
+class HuffmanStreamCompressor {
+public:
+    explicit HuffmanStreamCompressor(size_t blockSize = kDefaultHuffmanBlockSize, int streams = kDefaultHuffmanStreams)
+        : blockSize(blockSize), streams(streams) {
+        pending.resize(kHuffmanContainerHeaderBytes);
+        std::memcpy(pending.data(), kHuffmanContainerMagic, 8);
+        putLittleEndian(pending.data() + 8, blockSize);
+        block.reserve(blockSize);
+    }
+
+    void push(std::string_view input) {
+        while (!input.empty()) {
+            size_t take = std::min(blockSize - block.size(), input.size());
+            if (block.empty() && take == blockSize) {
+                compressBlock(input.substr(0, take));
+            } else {
+                block.append(input.substr(0, take));
+                if (block.size() == blockSize) {
+                    compressBlock(block);
+                    block.clear();
+                }
+            }
+            input.remove_prefix(take);
         }
+    }
 
-        window.clear(sf::Color(30,30,40));
-        drawTreeNodes(window, font, root, 600.f, 100.f, 300.f);
-        drawCodeTable(window, font, codes);
-        window.display();
+    // Compresses the last partial block and appends the trailer; push must not be called afterwards.
+    void finish() {
+        if (!block.empty()) compressBlock(block);
+        block.clear();
+        std::vector<uint8_t> tail = containerTail({}, 0, blocks, totalBytes);
+        pending.insert(pending.end(), tail.begin(), tail.end());
+    }
+
+    // Hands over the compressed bytes produced so far.
+    std::vector<uint8_t> pull() { return std::exchange(pending, {}); }
+
+private:
+    size_t blockSize;
+    int streams;
+    std::string block;
+    std::vector<uint8_t> pending;
+    uint64_t blocks = 0, totalBytes = 0;
+
+    void compressBlock(std::string_view text) {
+        HuffmanFrequencies freq = countSymbols(text);
+        std::vector<uint8_t> payload = compressHuffman(text, freq, limitedCodeLengths(freq), streams);
+        size_t at = pending.size();
+        pending.resize(at + 4 + payload.size());
+        putLittleEndian(&pending[at], payload.size(), 4);
+        std::memcpy(&pending[at + 4], payload.data(), payload.size());
+        ++blocks;
+        totalBytes += text.size();
+    }
+};
+
+// The reverse: buffers at most one frame of input and one block of output between pulls. push returns false once
+// the input is known to be malformed; finish reports whether a complete, consistent container was seen.
+class HuffmanStreamDecompressor {
+public:
+    bool push(std::string_view input) {
+        if (failed) return false;
+        if (stage == Stage::Tail) {
+            keepTail(input);
+            return true;
+        }
+        buffered.insert(buffered.end(), input.begin(), input.end());
+        size_t used = 0;
+        while (!failed) {
+            std::span<const uint8_t> rest(buffered.data() + used, buffered.size() - used);
+            if (stage == Stage::Header) {
+                if (rest.size() < kHuffmanContainerHeaderBytes) break;
+                blockSize = getLittleEndian(rest.data() + 8);
+                failed = std::memcmp(rest.data(), kHuffmanContainerMagic, 8) != 0 || blockSize == 0 ||
+                         blockSize > kMaxHuffmanBlockSize;
+                used += kHuffmanContainerHeaderBytes;
+                stage = Stage::Frames;
+            } else if (stage == Stage::Frames) {
+                if (rest.size() < 4) break;
+                uint64_t length = getLittleEndian(rest.data(), 4);
+                if (length == 0) {
+                    used += 4;
+                    stage = Stage::Tail;
+                    keepTail({(const char*)buffered.data() + used, buffered.size() - used});
+                    used = buffered.size();
+                    break;
+                }
+                // A payload never needs more than 12 bits per symbol plus its headers.
+                if (length > blockSize * 2 + 1024) {
+                    failed = true;
+                    break;
+                }
+                if (rest.size() < 4 + length) break;
+                decodeFrame(rest.subspan(4, length));
+                used += 4 + length;
+            } else {
+                break;
+            }
+        }
+        buffered.erase(buffered.begin(), buffered.begin() + used);
+        return !failed;
+    }
+
+    std::vector<uint8_t> pull() { return std::exchange(pending, {}); }
+    uint64_t blockCount() const { return blocks; }
+
+    bool finish() const {
+        if (failed || stage != Stage::Tail || tailBytes < kHuffmanTrailerBytes) return false;
+        const uint8_t* trailer = tail.data() + tail.size() - kHuffmanTrailerBytes;
+        return std::memcmp(trailer + 24, kHuffmanTrailerMagic, 8) == 0 && getLittleEndian(trailer + 8) == blocks &&
+               getLittleEndian(trailer + 16) == totalBytes;
+    }
+
+private:
+    enum class Stage { Header, Frames, Tail };
+    Stage stage = Stage::Header;
+    bool failed = false, sawShortBlock = false;
+    uint64_t blockSize = 0, blocks = 0, totalBytes = 0, tailBytes = 0;
+    std::vector<uint8_t> buffered, pending;
+    std::array<uint8_t, kHuffmanTrailerBytes> tail{};
+
+    void decodeFrame(std::span<const uint8_t> payload) {
+        if (payload.size() < kHuffmanHeaderBytes) {
+            failed = true;
+            return;
+        }
+        uint64_t count = getLittleEndian(payload.data());
+        // Only the last block may be short.
+        if (count > blockSize || count == 0 || sawShortBlock) {
+            failed = true;
+            return;
+        }
+        sawShortBlock = count < blockSize;
+        size_t at = pending.size();
+        pending.resize(at + count);
+        failed = !decompressHuffmanInto(payload, {pending.data() + at, (size_t)count});
+        ++blocks;
+        totalBytes += count;
+    }
+
+    // Everything after the frames is the optional index and the trailer; only the last 32 bytes matter.
+    void keepTail(std::string_view input) {
+        tailBytes += input.size();
+        if (input.size() >= tail.size()) {
+            std::memcpy(tail.data(), input.data() + input.size() - tail.size(), tail.size());
+        } else {
+            std::memmove(tail.data(), tail.data() + input.size(), tail.size() - input.size());
+            std::memcpy(tail.data() + tail.size() - input.size(), input.data(), input.size());
+        }
+    }
+};
+
+// "-" names stdin or stdout. Input is pushed a slice at a time and output written as soon as it is pulled, so
+// memory stays bounded whatever the size of the data.
+bool streamHuffman(bool compress, const std::string& inPath, const std::string& outPath, size_t blockSize,
+                   int streams, HuffmanFileStats& stats) {
+    std::shared_ptr<MappedFile> file;
+    if (inPath != "-") {
+        file = MappedFile::open(inPath);
+        if (!file) return false;
+    }
+    FILE* out = outPath == "-" ? stdout : std::fopen(outPath.c_str(), "wb");
+    if (!out) {
+        std::cerr << "Error: Could not create '" << outPath << "'.\n";
+        return false;
+    }
+#if defined(_WIN32)
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+    HuffmanStreamCompressor compressor(blockSize, streams);
+    HuffmanStreamDecompressor decompressor;
+    std::vector<char> chunk(1 << 20);
+    size_t fileAt = 0;
+    bool ok = true;
+    auto emit = [&](const std::vector<uint8_t>& bytes) {
+        stats.outputBytes += bytes.size();
+        ok = ok && std::fwrite(bytes.data(), 1, bytes.size(), out) == bytes.size();
+    };
+    while (ok) {
+        std::string_view piece;
+        if (file) {
+            piece = std::string_view(file->data() + fileAt, std::min(chunk.size(), file->size() - fileAt));
+            fileAt += piece.size();
+        } else {
+            piece = std::string_view(chunk.data(), std::fread(chunk.data(), 1, chunk.size(), stdin));
+        }
+        if (piece.empty()) break;
+        stats.inputBytes += piece.size();
+        if (compress) {
+            compressor.push(piece);
+            emit(compressor.pull());
+        } else {
+            if (!decompressor.push(piece)) {
+                std::cerr << "Error: '" << inPath << "' is not a valid Huffman container.\n";
+                ok = false;
+            }
+            emit(decompressor.pull());
+        }
     }
+    if (ok && compress) {
+        compressor.finish();
+        emit(compressor.pull());
+        stats.blocks = (stats.inputBytes + blockSize - 1) / blockSize;
+    } else if (ok && !decompressor.finish()) {
+        std::cerr << "Error: '" << inPath << "' is truncated or its trailer does not match its blocks.\n";
+        ok = false;
+    }
+    if (!compress) stats.blocks = decompressor.blockCount();
+    ok = std::fflush(out) == 0 && ok;
+    if (out != stdout) ok = std::fclose(out) == 0 && ok;
+    return ok;
 }
 
-void runHuffman() {
-    std::cout << "Enter a string to encode: ";
-    std::string text;
-    std::getline(std::cin >> std::ws, text);
+std::vector<WeightedEdge> randomGraphEdges(int n, int avgDegree, std::mt19937_64& rng) {
+    std::vector<WeightedEdge> edges;
+    std::uniform_int_distribution<int> vertex(0, n - 1), weight(1, 100);
+    long long pairs = (long long)n * avgDegree / 2;
+    for (long long i = 0; i < pairs; ++i) {
+        int u = vertex(rng), v = vertex(rng), w = weight(rng);
+        if (u == v) continue;
+        edges.push_back({u, v, w});
+        edges.push_back({v, u, w});
+    }
+    return edges;
+}
 
-    std::map<char, unsigned> freqMap;
-    for (char c : text) {
-        freqMap[c]++;
+std::vector<WeightedEdge> gridGraphEdges(int side, std::mt19937_64& rng, std::vector<sf::Vector2f>& pos) {
+    std::vector<WeightedEdge> edges;
+    std::uniform_int_distribution<int> weight(10, 100);
+    pos.resize((size_t)side * side);
+    for (int r = 0; r < side; ++r) {
+        for (int c = 0; c < side; ++c) {
+            int u = r * side + c;
+            pos[u] = sf::Vector2f(c * 10.f, r * 10.f);
+            if (c + 1 < side) {
+                int w = weight(rng);
+                edges.push_back({u, u + 1, w});
+                edges.push_back({u + 1, u, w});
+            }
+            if (r + 1 < side) {
+                int w = weight(rng);
+                edges.push_back({u, u + side, w});
+                edges.push_back({u + side, u, w});
+            }
+        }
     }
+    return edges;
+}
 
-    HuffmanNode* root = buildHuffmanTree(freqMap);
+// Barabasi-Albert preferential attachment: each new vertex links to `links` endpoints drawn from the edge list.
+std::vector<WeightedEdge> scaleFreeGraphEdges(int n, int links, std::mt19937_64& rng) {
+    std::vector<WeightedEdge> edges;
+    std::vector<int> endpoints;
+    std::uniform_int_distribution<int> weight(1, 100);
+    for (int v = 1; v < n; ++v) {
+        for (int k = 0; k < links; ++k) {
+            int u = endpoints.empty() ? 0 : endpoints[rng() % endpoints.size()];
+            if (u == v) continue;
+            int w = weight(rng);
+            edges.push_back({u, v, w});
+            edges.push_back({v, u, w});
+            endpoints.push_back(u);
+            endpoints.push_back(v);
+        }
+    }
+    return edges;
+}
 
-    std::map<char, std::string> codes;
-    generateCodes(root, "", codes);
+std::string skewedText(size_t length, std::mt19937_64& rng) {
+    const std::string alphabet = "etaoinshrdlcumwfgypbvkjxqz ETAOIN.,\n0123456789";
+    std::geometric_distribution<int> pick(0.15);
+    std::string text(length, ' ');
+    for (auto& c : text) c = alphabet[std::min<size_t>(pick(rng), alphabet.size() - 1)];
+    return text;
+}
 
-    std::cout << "\nHuffman Codes:\n";
-    std::string encodedString = "";
+void printBenchRow(const std::string& graphName, long long n, long long m, const std::string& what,
+                   double ms, double throughput, const char* unit) {
+    std::cout << std::left << std::setw(11) << graphName << std::right << std::setw(10) << n
+              << std::setw(11) << m << "  " << std::left << std::setw(22) << what << std::right
+              << std::setw(11) << std::fixed << std::setprecision(3) << ms
+              << std::setw(12) << std::setprecision(2) << throughput << " " << std::left << std::setw(9) << unit
+              << std::right << std::setw(10) << std::setprecision(1) << peakRssKb() / 1024.0 << "\n";
+}
+
+constexpr int kMaxBenchApspVertices = 4096;
+
+void runBenchmark(const std::vector<int>& sizes, unsigned long long seed, long long delta = 0) {
+    const int queries = 8;
+    std::cout << std::left << std::setw(11) << "graph" << std::right << std::setw(10) << "vertices"
+              << std::setw(11) << "edges" << "  " << std::left << std::setw(22) << "algorithm" << std::right
+              << std::setw(11) << "ms" << std::setw(12) << "throughput" << " " << std::left << std::setw(9) << "unit"
+              << std::right << std::setw(10) << "peak_MB" << "\n";
+
+    for (const std::string kind : {"random", "grid", "scale-free"}) {
+        for (int size : sizes) {
+            std::mt19937_64 rng(seed);
+            std::vector<sf::Vector2f> pos;
+            std::vector<WeightedEdge> edges;
+            int n = size;
+            if (kind == "random") {
+                edges = randomGraphEdges(n, 8, rng);
+            } else if (kind == "grid") {
+                int side = std::max(1, (int)std::lround(std::sqrt((double)size)));
+                n = side * side;
+                edges = gridGraphEdges(side, rng, pos);
+            } else {
+                edges = scaleFreeGraphEdges(n, 4, rng);
+            }
+            if (pos.empty()) pos = circleLayout(n);
+
+            auto t0 = std::chrono::steady_clock::now();
+            CsrGraph graph = csrFromEdges(n, edges);
+            double ms = elapsedMs(t0);
+            long long m = graph.edgeCount();
+            printBenchRow(kind, n, m, "csr-build", ms, m / ms / 1000.0, "Medges/s");
+            edges.clear();
+            edges.shrink_to_fit();
+
+            GraphContext ctx{graph, pos};
+            ctx.delta = delta;
+            t0 = std::chrono::steady_clock::now();
+            ctx.landmarkSet();
+            ms = elapsedMs(t0);
+            printBenchRow(kind, n, m, "alt-landmarks", ms, m / ms / 1000.0, "Medges/s");
+            ctx.reverseGraph();
+
+            std::uniform_int_distribution<int> vertex(0, n - 1);
+            std::vector<std::pair<int, int>> pairs;
+            for (int q = 0; q < queries; ++q) pairs.push_back({vertex(rng), vertex(rng)});
+
+            // All-pairs is cubic in the worst case, so only small graphs get it.
+            if (n <= kMaxBenchApspVertices) {
+                for (ApspMethod method : {ApspMethod::FloydWarshall, ApspMethod::Dijkstra}) {
+                    t0 = std::chrono::steady_clock::now();
+                    DistanceMatrix matrix(graph, method);
+                    ms = elapsedMs(t0);
+                    if (matrix.tooLarge()) {
+                        std::cerr << "Skipping all-pairs on " << kind << " " << n << ": needs "
+                                  << matrix.bytesNeeded() / 1e9 << " GB.\n";
+                        continue;
+                    }
+                    printBenchRow(kind, n, m, method == ApspMethod::FloydWarshall ? "apsp-floyd-warshall" : "apsp-dijkstra",
+                                  ms, (double)n * n / ms / 1000.0, "Mpairs/s");
+                }
+            }
+
+            // Contraction hierarchies target road-like graphs; on random and scale-free graphs
+            // almost everything ends up in the dense core and preprocessing buys nothing.
+            bool roadLike = kind == "grid";
+            if (roadLike) {
+                t0 = std::chrono::steady_clock::now();
+                ctx.contractionHierarchy();
+                ms = elapsedMs(t0);
+                printBenchRow(kind, n, m, "ch-build", ms, m / ms / 1000.0, "Medges/s");
+            }
+
+            for (const auto& algo : kGraphAlgorithms) {
+                if (algo.id == GraphAlgorithm::ContractionHierarchy && !roadLike) continue;
+                if (algo.needsDestination) {
+                    t0 = std::chrono::steady_clock::now();
+                    for (const auto& [s, t] : pairs) runGraphAlgorithm(algo, ctx, s, t);
+                    ms = elapsedMs(t0) / queries;
+                    printBenchRow(kind, n, m, algo.name, ms, 1000.0 / ms, "query/s");
+                } else {
+                    t0 = std::chrono::steady_clock::now();
+                    runGraphAlgorithm(algo, ctx, 0, -1);
+                    ms = elapsedMs(t0);
+                    printBenchRow(kind, n, m, algo.name, ms, m / ms / 1000.0, "Medges/s");
+                }
+            }
+        }
+    }
+
+    for (int size : sizes) {
+        std::mt19937_64 rng(seed);
+        size_t length = (size_t)size * 100;
+        std::string text = skewedText(length, rng);
+        double mb = length / 1e6;
+        for (int streams : {1, 4, 8}) {
+            HuffmanRun run = runHuffmanPipeline(text, streams);
+            std::string suffix = streams == 1 ? "" : "-x" + std::to_string(streams);
+            if (streams == 1) {
+                printBenchRow("text", (long long)length, 0, "huffman-build", run.buildMs, mb / run.buildMs * 1000.0, "MB/s");
+            }
+            printBenchRow("text", (long long)length, 0, "huffman-encode" + suffix, run.encodeMs, mb / run.encodeMs * 1000.0, "MB/s");
+            printBenchRow("text", (long long)length, 0, "huffman-decode" + suffix, run.decodeMs, mb / run.decodeMs * 1000.0, "MB/s");
+        }
+    }
+}
+
+void printUsage() {
+    std::cout << "Usage:\n"
+              << "  main                                   interactive mode\n"
+              << "  main --graph FILE --algo NAME [--source N] [--dest N] [--print-order]\n"
+              << "  main --graph FILE [--save-snapshot OUT]   visualize a loaded graph, or convert it\n"
+              << "  main --huffman FILE [--streams 1|4|8]     round-trip benchmark\n"
+              << "  main --compress FILE --output OUT [--block-size BYTES] [--streams 1|4|8]\n"
+              << "  main --decompress FILE --output OUT [--block N]\n"
+              << "  (FILE or OUT may be - for stdin/stdout; those stream with bounded memory)\n"
+              << "  main --graph FILE --apsp auto|floyd-warshall|dijkstra [--source N --dest N] [--output MATRIX]\n"
+              << "  main --graph FILE --build-ch OUT [--algo ch --source N --dest N]   preprocess a hierarchy\n"
+              << "  main --graph FILE --algo ch --ch HIERARCHY --source N --dest N\n"
+              << "  main --bench [--bench-sizes N,N,...] [--seed N] [--delta N]\n"
+              << "  main --graph FILE --algo NAME --export DIR|OUT.rgba|- [--frame-size WxH] [--events-per-frame N]\n"
+              << "  main --huffman FILE --export DIR|OUT.rgba|-   render frames offscreen, without a display\n"
+              << "  main --font PATH                           interactive mode with another font\n"
+              << "Common options: --threads N, --format auto|matrix|edges|dimacs|mtx|snapshot, --font PATH\n"
+              << "  --delta N   bucket width for delta-stepping (default: max weight / average degree)\n"
+              << "  --metrics OUT|-   write the run's counters and timers as JSON (graph, APSP and Huffman runs)\n"
+              << "Algorithms:";
+    for (const auto& algo : kGraphAlgorithms) std::cout << " " << algo.name;
+    std::cout << "\nNodes are numbered from 1, as in interactive mode.\n";
+}
+
+std::string jsonString(const std::string& text) {
+    std::string out = "\"";
     for (char c : text) {
-        std::string codeStr = codes[c];
-        encodedString += codeStr;
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if ((unsigned char)c < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned)c);
+            out += escaped;
+        } else {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
 
-        if (c == ' ') std::cout << "' '";
-        else if (c == '\n') std::cout << "\\n";
-        else std::cout << " " << c;
-        std::cout << " : " << codeStr << "\n";
+std::string jsonNumber(double value) {
+    std::ostringstream out;
+    out << value;
+    return out.str();
+}
+
+// One JSON object for a batch run: its own fields (values already JSON-encoded), then the
+// counters and timers it accumulated. "-" writes to `console`, which batch modes that stream
+// their data on stdout point at stderr.
+bool writeMetricsJson(const std::string& path, const std::vector<std::pair<std::string, std::string>>& fields,
+                      const MetricsSnapshot& metrics, std::ostream& console = std::cout) {
+    std::ostringstream json;
+    json << "{\n";
+    for (const auto& [key, value] : fields) json << "  " << jsonString(key) << ": " << value << ",\n";
+    json << "  \"metrics_enabled\": " << (kMetricsEnabled ? "true" : "false") << ",\n  \"counters\": {";
+    for (int i = 0; i < kMetricCount; ++i) {
+        json << (i ? ", " : "") << jsonString(kMetricNames[i]) << ": " << metrics.counts[i];
     }
+    json << "},\n  \"timers_ms\": {";
+    for (int i = 0; i < kMetricTimerCount; ++i) {
+        json << (i ? ", " : "") << jsonString(kMetricTimerNames[i]) << ": " << jsonNumber(metrics.nanos[i] / 1e6);
+    }
+    json << "}\n}\n";
 
-    std::cout << "\nOriginal string (" << text.length() << " chars): " << text << "\n";
-    std::cout << "Encoded string (" << encodedString.length() << " bits): " << encodedString << "\n";
+    if (path == "-") {
+        console << json.str();
+        return true;
+    }
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Error: Could not create '" << path << "'.\n";
+        return false;
+    }
+    out << json.str();
+    return (bool)out;
+}
 
-    std::string decodedString = decodeHuffman(root, encodedString);
-    std::cout << "Decoded string: " << decodedString << "\n";
+// Looks up the algorithm and checks 1-based source/dest against the graph; nullptr on error.
+const GraphAlgorithmInfo* checkGraphQuery(const CsrGraph& graph, const std::string& algoName, int source, int dest) {
+    const GraphAlgorithmInfo* algo = findGraphAlgorithm(algoName);
+    if (!algo) {
+        std::cerr << "Unknown algorithm '" << algoName << "'.\n";
+        return nullptr;
+    }
+    int n = graph.n;
+    if (source < 1 || source > n || dest < 0 || dest > n || (algo->needsDestination && dest == 0)) {
+        std::cerr << "Invalid source/destination for a graph with " << n << " nodes.\n";
+        return nullptr;
+    }
+    return algo;
+}
+
+// Preprocesses the graph's contraction hierarchy and writes it to path for later --ch runs.
+bool buildHierarchyFile(const CsrGraph& graph, const std::string& path) {
+    auto t0 = std::chrono::steady_clock::now();
+    ContractionHierarchy hierarchy;
+    if (!hierarchy.build(graph)) {
+        std::cerr << "Error: The graph has a negative cycle; no hierarchy was built.\n";
+        return false;
+    }
+    double buildMs = elapsedMs(t0);
+    if (!hierarchy.save(path)) return false;
+    std::cout << "hierarchy: " << path << " (" << graph.n << " vertices, " << graph.edgeCount() << " edges, "
+              << hierarchy.shortcutCount() << " shortcuts)\n";
+    std::cout << "build_ms: " << buildMs << "\n";
+    return true;
+}
+
+int runGraphBatch(const CsrGraph& graph, double loadMs, const std::string& algoName, int source, int dest,
+                  bool printOrder, const std::string& hierarchyPath = "", const std::string& metricsPath = "",
+                  long long delta = 0) {
+    const GraphAlgorithmInfo* algo = checkGraphQuery(graph, algoName, source, dest);
+    if (!algo) return 1;
+    MetricsSnapshot metricsBase = metricsSnapshot();
+
+    int n = graph.n;
+    int destIndex = dest - 1;
+    std::vector<sf::Vector2f> pos = circleLayout(n);
+    GraphContext ctx{graph, pos};
+    ctx.delta = delta;
+
+    // Hierarchy preprocessing (or loading it) is reported apart from the query itself.
+    double preprocessMs = -1;
+    if (algo->id == GraphAlgorithm::ContractionHierarchy) {
+        auto t0 = std::chrono::steady_clock::now();
+        if (!hierarchyPath.empty()) {
+            ctx.hierarchy.emplace();
+            if (!ctx.hierarchy->load(hierarchyPath, graph)) return 1;
+        } else {
+            ctx.contractionHierarchy();
+        }
+        preprocessMs = elapsedMs(t0);
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    GraphRun run = runGraphAlgorithm(*algo, ctx, source - 1, destIndex);
+    double runMs = elapsedMs(t0);
+
+    std::cout << "algorithm: " << algo->name << "\n";
+    std::cout << "vertices: " << n << "\n";
+    std::cout << "edges: " << graph.edgeCount() << "\n";
+    std::cout << "load_ms: " << loadMs << "\n";
+    if (preprocessMs >= 0) {
+        std::cout << (hierarchyPath.empty() ? "preprocess_ms: " : "hierarchy_load_ms: ") << preprocessMs << "\n";
+    }
+    std::cout << "run_ms: " << runMs << "\n";
+    std::cout << "visited: " << run.order.size() << "\n";
+    if (!algo->shortestPath) {
+        std::cout << "total_cost: " << run.totalCost << "\n";
+    }
+    if (run.negativeCycle) {
+        std::cout << "negative_cycle: yes\n";
+    }
+    if (algo->shortestPath && destIndex >= 0) {
+        bool bfs = isBfs(*algo);
+        bool reached = destIndex == source - 1 || run.parent[destIndex] != -1;
+        if (!bfs) {
+            long long d = run.dist[destIndex];
+            std::cout << "distance: " << (d == LLONG_MAX ? std::string("inf") : std::to_string(d)) << "\n";
+        }
+        if (reached && !run.negativeCycle) {
+            std::vector<int> path;
+            for (int v = destIndex; v != -1 && (int)path.size() <= n; v = run.parent[v]) path.push_back(v);
+            std::cout << "path:";
+            for (auto it = path.rbegin(); it != path.rend(); ++it) {
+                std::cout << " " << (*it + 1) << (std::next(it) != path.rend() ? " ->" : "");
+            }
+            std::cout << "\n";
+        }
+    }
+    if (printOrder) {
+        std::cout << "order:";
+        for (int v : run.order) std::cout << " " << (v + 1);
+        std::cout << "\n";
+    }
+    std::cout << "peak_rss_kb: " << peakRssKb() << "\n";
+    if (!metricsPath.empty()) {
+        std::vector<std::pair<std::string, std::string>> fields = {
+            {"mode", jsonString("graph")}, {"algorithm", jsonString(algo->name)},
+            {"vertices", std::to_string(n)}, {"edges", std::to_string(graph.edgeCount())},
+            {"source", std::to_string(source)}, {"dest", std::to_string(dest)},
+            {"load_ms", jsonNumber(loadMs)}, {"run_ms", jsonNumber(runMs)},
+            {"visited", std::to_string(run.order.size())}};
+        if (preprocessMs >= 0) fields.push_back({"preprocess_ms", jsonNumber(preprocessMs)});
+        if (!writeMetricsJson(metricsPath, fields, metricsSnapshot() - metricsBase)) return 1;
+    }
+    return 0;
+}
+
+bool parseApspMethod(const std::string& name, ApspMethod& method) {
+    if (name == "auto") method = ApspMethod::Auto;
+    else if (name == "floyd-warshall") method = ApspMethod::FloydWarshall;
+    else if (name == "dijkstra") method = ApspMethod::Dijkstra;
+    else return false;
+    return true;
+}
+
+// Text matrix, one row per source, "inf" where the target is unreachable.
+bool writeDistanceMatrix(const std::string& path, const DistanceMatrix& matrix) {
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Error: Could not create '" << path << "'.\n";
+        return false;
+    }
+    std::string line;
+    for (int u = 0; u < matrix.size(); ++u) {
+        line.clear();
+        for (int v = 0; v < matrix.size(); ++v) {
+            long long d = matrix.distance(u, v);
+            if (v) line += ' ';
+            line += d == LLONG_MAX ? "inf" : std::to_string(d);
+        }
+        line += '\n';
+        out << line;
+    }
+    return (bool)out;
+}
+
+int runApspBatch(const CsrGraph& graph, double loadMs, ApspMethod method, int source, int dest,
+                 const std::string& outPath, const std::string& metricsPath = "") {
+    int n = graph.n;
+    if (source < 1 || source > n || dest < 0 || dest > n) {
+        std::cerr << "Invalid source/destination for a graph with " << n << " nodes.\n";
+        return 1;
+    }
+    MetricsSnapshot metricsBase = metricsSnapshot();
+    auto t0 = std::chrono::steady_clock::now();
+    DistanceMatrix matrix(graph, method);
+    double runMs = elapsedMs(t0);
+
+    std::cout << "vertices: " << n << "\n";
+    std::cout << "edges: " << graph.edgeCount() << "\n";
+    std::cout << "load_ms: " << loadMs << "\n";
+    if (matrix.negativeCycle()) {
+        std::cout << "negative_cycle: yes\n";
+        return 1;
+    }
+    if (matrix.tooLarge()) {
+        std::cerr << "Error: graph too large for all-pairs (needs " << std::fixed << std::setprecision(1)
+                  << matrix.bytesNeeded() / 1e9 << " GB).\n";
+        return 1;
+    }
+    std::cout << "method: " << (matrix.usedFloydWarshall() ? "floyd-warshall" : "dijkstra") << "\n";
+    std::cout << "distance_bits: " << matrix.bits() << "\n";
+    std::cout << "run_ms: " << runMs << " (" << (double)n * n / runMs / 1000.0 << " Mpairs/s)\n";
+    if (dest > 0) {
+        long long d = matrix.distance(source - 1, dest - 1);
+        std::cout << "distance: " << (d == LLONG_MAX ? std::string("inf") : std::to_string(d)) << "\n";
+    }
+    if (!outPath.empty() && !writeDistanceMatrix(outPath, matrix)) return 1;
+    std::cout << "peak_rss_kb: " << peakRssKb() << "\n";
+    if (!metricsPath.empty()) {
+        std::vector<std::pair<std::string, std::string>> fields = {
+            {"mode", jsonString("apsp")},
+            {"method", jsonString(matrix.usedFloydWarshall() ? "floyd-warshall" : "dijkstra")},
+            {"vertices", std::to_string(n)}, {"edges", std::to_string(graph.edgeCount())},
+            {"load_ms", jsonNumber(loadMs)}, {"run_ms", jsonNumber(runMs)}};
+        if (!writeMetricsJson(metricsPath, fields, metricsSnapshot() - metricsBase)) return 1;
+    }
+    return 0;
+}
+
+int runHuffmanBatch(const std::string& path, int streams, const std::string& metricsPath = "") {
+    std::string text;
+    if (!readFileBytes(path, text)) return 1;
+    if (text.empty()) {
+        std::cerr << "Error: '" << path << "' is empty.\n";
+        return 1;
+    }
+    MetricsSnapshot metricsBase = metricsSnapshot();
+    HuffmanRun run = runHuffmanPipeline(text, streams);
+    double mb = text.size() / 1e6;
+    std::cout << "input_bytes: " << text.size() << "\n";
+    std::cout << "unique_symbols: " << run.uniqueSymbols << "\n";
+    std::cout << "max_code_length: " << run.maxCodeLength << "\n";
+    std::cout << "compressed_bytes: " << run.compressedBytes << " (ratio " << (double)run.compressedBytes / text.size() << ")\n";
+    std::cout << "build_ms: " << run.buildMs << "\n";
+    std::cout << "encode_ms: " << run.encodeMs << " (" << mb / run.encodeMs * 1000.0 << " MB/s)\n";
+    std::cout << "decode_ms: " << run.decodeMs << " (" << mb / run.decodeMs * 1000.0 << " MB/s)\n";
+    std::cout << "roundtrip: " << (run.roundTripOk ? "ok" : "FAILED") << "\n";
+    if (!metricsPath.empty()) {
+        std::vector<std::pair<std::string, std::string>> fields = {
+            {"mode", jsonString("huffman")}, {"streams", std::to_string(streams)},
+            {"input_bytes", std::to_string(text.size())}, {"compressed_bytes", std::to_string(run.compressedBytes)},
+            {"build_ms", jsonNumber(run.buildMs)}, {"encode_ms", jsonNumber(run.encodeMs)},
+            {"decode_ms", jsonNumber(run.decodeMs)}};
+        if (!writeMetricsJson(metricsPath, fields, metricsSnapshot() - metricsBase)) return 1;
+    }
+    return run.roundTripOk ? 0 : 1;
+}
 
-    visualizeHuffman(root, codes);
+int runHuffmanFileBatch(const std::string& compressPath, const std::string& decompressPath,
+                        const std::string& outputPath, size_t blockSize, int streams, long long block,
+                        const std::string& metricsPath = "") {
+    if (outputPath.empty()) {
+        std::cerr << "Error: --compress and --decompress need --output.\n";
+        return 1;
+    }
+    if (blockSize == 0 || blockSize > kMaxHuffmanBlockSize) {
+        std::cerr << "Error: --block-size must be between 1 and " << kMaxHuffmanBlockSize << ".\n";
+        return 1;
+    }
+    bool compress = !compressPath.empty();
+    const std::string& inputPath = compress ? compressPath : decompressPath;
+    bool streaming = inputPath == "-" || outputPath == "-";
+    if (streaming && block >= 0) {
+        std::cerr << "Error: --block needs a seekable container, not '-'.\n";
+        return 1;
+    }
+    HuffmanFileStats stats;
+    MetricsSnapshot metricsBase = metricsSnapshot();
+    auto t0 = std::chrono::steady_clock::now();
+    bool ok = streaming ? streamHuffman(compress, inputPath, outputPath, blockSize, streams, stats)
+              : compress ? compressHuffmanFile(compressPath, outputPath, blockSize, streams, stats)
+                         : decompressHuffmanFile(decompressPath, outputPath, block, stats);
+    if (!ok) return 1;
+    double ms = elapsedMs(t0);
+    uint64_t rawBytes = compress ? stats.inputBytes : stats.outputBytes;
+    // Keep stdout clean when it carries the data.
+    std::ostream& report = outputPath == "-" ? std::cerr : std::cout;
+    report << "blocks: " << stats.blocks << "\n";
+    report << "input_bytes: " << stats.inputBytes << "\n";
+    report << "output_bytes: " << stats.outputBytes << "\n";
+    if (compress && stats.inputBytes) {
+        report << "ratio: " << (double)stats.outputBytes / stats.inputBytes << "\n";
+    }
+    report << "time_ms: " << ms << " (" << rawBytes / 1e6 / ms * 1000.0 << " MB/s)\n";
+    report << "peak_rss_kb: " << peakRssKb() << "\n";
+    if (!metricsPath.empty()) {
+        std::vector<std::pair<std::string, std::string>> fields = {
+            {"mode", jsonString(compress ? "compress" : "decompress")}, {"blocks", std::to_string(stats.blocks)},
+            {"input_bytes", std::to_string(stats.inputBytes)}, {"output_bytes", std::to_string(stats.outputBytes)},
+            {"time_ms", jsonNumber(ms)}};
+        if (!writeMetricsJson(metricsPath, fields, metricsSnapshot() - metricsBase, report)) return 1;
+    }
+    return 0;
+}
 
-    deleteTree(root);
+// Whole-string decimal parse of a command-line value; false (and a message) on anything else.
+template <typename T>
+bool parseOptionNumber(const std::string& option, const std::string& text, T& out) {
+    const char* end = text.data() + text.size();
+    auto [next, ec] = std::from_chars(text.data(), end, out);
+    if (text.empty() || ec != std::errc() || next != end) {
+        std::cerr << "Error: invalid value for " << option << ": '" << text << "'.\n";
+        return false;
+    }
+    return true;
 }
 
+int runInteractive();
+
+int runBatch(int argc, char** argv) {
+    std::string graphPath, algoName, huffmanPath, snapshotPath;
+    std::string compressPath, decompressPath, outputPath;
+    std::string apspName, hierarchyPath, buildHierarchyPath, metricsPath;
+    FrameExportOptions exportOptions;
+    bool fontGiven = false;
+    size_t blockSize = kDefaultHuffmanBlockSize;
+    long long block = -1;
+    int streams = kDefaultHuffmanStreams;
+    GraphFormat format = GraphFormat::Auto;
+    int source = 1, dest = 0;
+    bool bench = false, printOrder = false;
+    std::vector<int> benchSizes = {1000, 10000, 100000};
+    unsigned long long seed = 42;
+    unsigned threads = 0;
+    long long delta = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << arg << "\n";
+                std::exit(1);
+            }
+            return argv[++i];
+        };
+        auto number = [&](auto& out) {
+            if (!parseOptionNumber(arg, value(), out)) std::exit(1);
+        };
+        if (arg == "--graph") graphPath = value();
+        else if (arg == "--algo") algoName = value();
+        else if (arg == "--save-snapshot") snapshotPath = value();
+        else if (arg == "--format") {
+            if (!parseGraphFormat(value(), format)) {
+                std::cerr << "Unknown graph format.\n";
+                return 1;
+            }
+        }
+        else if (arg == "--source") number(source);
+        else if (arg == "--dest") number(dest);
+        else if (arg == "--print-order") printOrder = true;
+        else if (arg == "--apsp") apspName = value();
+        else if (arg == "--ch") hierarchyPath = value();
+        else if (arg == "--build-ch") buildHierarchyPath = value();
+        else if (arg == "--metrics") metricsPath = value();
+        else if (arg == "--huffman") huffmanPath = value();
+        else if (arg == "--compress") compressPath = value();
+        else if (arg == "--decompress") decompressPath = value();
+        else if (arg == "--output") outputPath = value();
+        else if (arg == "--block-size") number(blockSize);
+        else if (arg == "--block") number(block);
+        else if (arg == "--streams") number(streams);
+        else if (arg == "--bench") bench = true;
+        else if (arg == "--seed") number(seed);
+        else if (arg == "--threads") number(threads);
+        else if (arg == "--delta") number(delta);
+        else if (arg == "--font") {
+            fontPath() = value();
+            fontGiven = true;
+        }
+        else if (arg == "--export") exportOptions.target = value();
+        else if (arg == "--events-per-frame") number(exportOptions.eventsPerFrame);
+        else if (arg == "--frame-size") {
+            unsigned w = 0, h = 0;
+            if (std::sscanf(value().c_str(), "%ux%u", &w, &h) != 2 || w == 0 || h == 0) {
+                std::cerr << "Error: --frame-size takes WIDTHxHEIGHT.\n";
+                return 1;
+            }
+            exportOptions.size = {w, h};
+        }
+        else if (arg == "--bench-sizes") {
+            benchSizes.clear();
+            std::stringstream ss(value());
+            std::string item;
+            while (std::getline(ss, item, ',')) {
+                if (!parseOptionNumber(arg, item, benchSizes.emplace_back())) return 1;
+                if (benchSizes.back() < 2) {
+                    std::cerr << "Error: --bench-sizes needs sizes of at least 2.\n";
+                    return 1;
+                }
+            }
+        } else {
+            printUsage();
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+    if (delta < 0) {
+        std::cerr << "Error: --delta must not be negative.\n";
+        return 1;
+    }
+    sharedThreadPool(threads);
+
+    if (bench) {
+        runBenchmark(benchSizes, seed, delta);
+        return 0;
+    }
+    if (!validHuffmanStreamCount(streams)) {
+        std::cerr << "Error: --streams must be 1, 4 or 8.\n";
+        return 1;
+    }
+    if (!huffmanPath.empty() && !exportOptions.target.empty()) {
+        std::string text;
+        if (!readFileBytes(huffmanPath, text)) return 1;
+        return exportHuffmanTree(text, exportOptions) ? 0 : 1;
+    }
+    if (!huffmanPath.empty()) return runHuffmanBatch(huffmanPath, streams, metricsPath);
+    if (!compressPath.empty() || !decompressPath.empty()) {
+        return runHuffmanFileBatch(compressPath, decompressPath, outputPath, blockSize, streams, block, metricsPath);
+    }
+    if (graphPath.empty()) {
+        if (fontGiven && exportOptions.target.empty()) return runInteractive();
+        printUsage();
+        return 1;
+    }
+    if (!exportOptions.target.empty() && algoName.empty()) {
+        std::cerr << "Error: --export needs --algo.\n";
+        return 1;
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    CsrGraph graph;
+    if (!loadGraph(graphPath, graph, format)) return 1;
+    double loadMs = elapsedMs(t0);
+    if (!snapshotPath.empty()) {
+        if (!writeSnapshot(snapshotPath, graph)) return 1;
+        std::cout << "snapshot: " << snapshotPath << " (" << graph.n << " vertices, " << graph.edgeCount() << " edges)\n";
+    }
+    if (!apspName.empty()) {
+        ApspMethod method;
+        if (!parseApspMethod(apspName, method)) {
+            std::cerr << "Unknown APSP method '" << apspName << "'.\n";
+            return 1;
+        }
+        return runApspBatch(graph, loadMs, method, source, dest, outputPath, metricsPath);
+    }
+    if (!exportOptions.target.empty()) {
+        const GraphAlgorithmInfo* algo = checkGraphQuery(graph, algoName, source, dest);
+        return algo && exportGraphAnimation(graph, *algo, source - 1, dest - 1, exportOptions) ? 0 : 1;
+    }
+    if (!buildHierarchyPath.empty()) {
+        if (!buildHierarchyFile(graph, buildHierarchyPath)) return 1;
+        if (algoName.empty()) return 0;
+        if (hierarchyPath.empty()) hierarchyPath = buildHierarchyPath;
+    }
+    if (!algoName.empty()) {
+        return runGraphBatch(graph, loadMs, algoName, source, dest, printOrder, hierarchyPath, metricsPath, delta);
+    }
+    if (snapshotPath.empty()) runGraphAlgorithmsOn(graph);
+    return 0;
+}
 
-int main() {
+int runInteractive() {
     std::cout << "Choose an application:\n";
     std::cout << "1. Graph Algorithm Visualizer\n";
     std::cout << "2. Huffman Encoding Visualizer\n";
@@ -735,4 +6639,11 @@ int main() {
     }
 
     return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1) {
+        return runBatch(argc, argv);
+    }
+    return runInteractive();
 } 
\ No newline at end of file